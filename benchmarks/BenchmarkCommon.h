@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+// Helpers shared by the benchmarks: timing, statistics, command line parsing and JSON output.
+
+struct Samples {
+    std::vector<double> values;
+
+    double Min() const { return values.empty() ? 0.0 : *std::min_element(values.begin(), values.end()); }
+    double Max() const { return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()); }
+    double Mean() const {
+        double sum = 0.0;
+        for (double v : values)
+            sum += v;
+        return values.empty() ? 0.0 : sum / values.size();
+    }
+    double Median() const {
+        if (values.empty())
+            return 0.0;
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t mid = sorted.size() / 2;
+        return (sorted.size() % 2) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+    }
+};
+
+class Timer {
+public:
+    Timer() : start(std::chrono::steady_clock::now()) {}
+    double ElapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Options of the benchmarks that load the documents of a directory into a context.
+struct DocumentOptions {
+    std::filesystem::path directory = "benchmarks/documents";
+    int width = 1024;
+    int height = 768;
+    float dp_ratio = 1.f;
+    std::vector<std::string> fonts;
+    bool json = false;
+};
+
+// Calls parse_option(arg, value) for each command line argument, value is the argument after it or nullptr. It returns how many of the
+// two it used, zero if the option is unknown or its value is missing.
+template <typename ParseOption>
+bool ParseArguments(int argc, char* argv[], ParseOption parse_option) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const int used = parse_option(arg, i + 1 < argc ? argv[i + 1] : nullptr);
+        if (used == 0) {
+            std::cerr << "Unknown or incomplete option: " << arg << "\n";
+            return false;
+        }
+        i += used - 1;
+    }
+    return true;
+}
+
+// Parses the DocumentOptions part of the command line, returns the arguments used like the parse_option of ParseArguments.
+inline int ParseDocumentOption(const std::string& arg, const char* value, DocumentOptions& options) {
+    if (arg == "--width" && value) {
+        options.width = std::atoi(value);
+        return 2;
+    }
+    if (arg == "--height" && value) {
+        options.height = std::atoi(value);
+        return 2;
+    }
+    if (arg == "--dp-ratio" && value) {
+        options.dp_ratio = (float)std::atof(value);
+        return 2;
+    }
+    if (arg == "--font" && value) {
+        options.fonts.push_back(value);
+        return 2;
+    }
+    if (arg == "--json") {
+        options.json = true;
+        return 1;
+    }
+    if (!arg.empty() && arg[0] != '-') {
+        options.directory = arg;
+        return 1;
+    }
+    return 0;
+}
+
+inline void AddDefaultFont(DocumentOptions& options) {
+    if (options.fonts.empty())
+        options.fonts.push_back("fonts/LatoLatin-Regular.ttf");
+}
+
+// Files of the directory and its subdirectories with one of the extensions, sorted so that runs are comparable.
+inline std::vector<std::filesystem::path> FindDocuments(const std::filesystem::path& directory,
+    std::initializer_list<const char*> extensions) {
+    std::vector<std::filesystem::path> result;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file(ec))
+            continue;
+        const std::string extension = entry.path().extension().string();
+        if (std::any_of(extensions.begin(), extensions.end(), [&](const char* e) { return extension == e; }))
+            result.push_back(entry.path());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+inline std::string JsonEscape(const std::string& value) {
+    std::string result;
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+inline std::string JsonSamples(const Samples& samples) {
+    return fmt::format("{{\"min\": {:.4f}, \"median\": {:.4f}, \"mean\": {:.4f}, \"max\": {:.4f}}}", samples.Min(), samples.Median(),
+        samples.Mean(), samples.Max());
+}
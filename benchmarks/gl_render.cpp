@@ -0,0 +1,243 @@
+// The GL functions loaded by RmlGL3::Initialize(), GLFW must not include the system headers.
+#define GLFW_INCLUDE_NONE
+#include "RmlUi_Include_GL3.h"
+#include <RmlUi/Core.h>
+#include "RmlUi_Platform_GLFW.h"
+#include "RmlUi_Renderer_GL3.h"
+#include <GLFW/glfw3.h>
+#include "BenchmarkCommon.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+
+// The editor provides the stb_image implementation in ImFileDialog.cpp, which is not part of this benchmark.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Renders every .rml file of a directory with the OpenGL 3 renderer of the editor and reports the frame times. Unlike RmlUi-Benchmark,
+// which records the render calls, this measures the GL side: stencil clipping of transformed elements, the streaming vertex buffer and
+// the driver. Documents are rendered into an offscreen target like the editor previews, in a hidden window without vsync.
+// Usage: RmlUi-Benchmark-GL [--frames N] [--warmup N] [--width W] [--height H] [--dp-ratio R] [--font FILE]... [--json] [directory]
+
+struct Options : DocumentOptions {
+    int frames = 200;
+    int warmup = 20;
+};
+
+struct DocumentResult {
+    std::string path;
+    bool failed = false;
+    // Times in milliseconds. Submit is the CPU time of Context::Render(), frame also waits for the GPU with glFinish() and gpu is measured
+    // with timer queries, it stays empty if the driver doesn't support them.
+    Samples submit, frame, gpu;
+    int draw_calls = 0;
+};
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    const bool parsed = ParseArguments(argc, argv, [&](const std::string& arg, const char* value) {
+        if (arg == "--frames" && value) {
+            options.frames = std::max(1, std::atoi(value));
+            return 2;
+        }
+        if (arg == "--warmup" && value) {
+            options.warmup = std::max(0, std::atoi(value));
+            return 2;
+        }
+        return ParseDocumentOption(arg, value, options);
+    });
+    AddDefaultFont(options);
+    return parsed;
+}
+
+// Renders one frame of the context into the target. Returns the CPU time of Context::Render().
+double RenderFrame(Rml::Context* context, RenderInterface_GL3& render_interface, RenderInterface_GL3::RenderTargetHandle target) {
+    render_interface.BeginFrame();
+    render_interface.BeginRenderTarget(target);
+    render_interface.BeginGpuTimer("document");
+    Timer timer;
+    context->Render();
+    const double submit_ms = timer.ElapsedMs();
+    render_interface.EndGpuTimer();
+    render_interface.EndRenderTarget();
+    render_interface.EndFrame();
+    return submit_ms;
+}
+
+void BenchmarkDocument(Rml::Context* context, RenderInterface_GL3& render_interface, RenderInterface_GL3::RenderTargetHandle target,
+    const std::filesystem::path& path, const Options& options, DocumentResult& result) {
+    Rml::ElementDocument* document = context->LoadDocument(path.generic_string());
+    if (!document) {
+        result.failed = true;
+        return;
+    }
+    document->Show();
+    context->Update();
+
+    // Textures are requested by the first render and decoded on the loader threads, wait for them so that every measured frame draws the
+    // same. The warmup frames upload them.
+    RenderFrame(context, render_interface, target);
+    while (render_interface.HasPendingTextures())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    Rml::Vector<RenderInterface_GL3::GpuTiming> timings;
+    for (int i = 0; i < options.warmup; i++) {
+        RenderFrame(context, render_interface, target);
+        glFinish();
+    }
+    render_interface.PopGpuTimings(timings);
+
+    for (int i = 0; i < options.frames; i++) {
+        Timer frame_timer;
+        result.submit.values.push_back(RenderFrame(context, render_interface, target));
+        result.draw_calls = render_interface.GetDrawCallCount();
+        glFinish();
+        result.frame.values.push_back(frame_timer.ElapsedMs());
+
+        // The timings of each frame are read back a few frames later, when its slot of the query ring is reused.
+        if (i >= RenderInterface_GL3::GpuTimingLatency && render_interface.PopGpuTimings(timings)) {
+            for (const RenderInterface_GL3::GpuTiming& timing : timings)
+                result.gpu.values.push_back(timing.milliseconds);
+        }
+    }
+    for (int i = 0; i < RenderInterface_GL3::GpuTimingLatency; i++) {
+        render_interface.BeginFrame();
+        render_interface.EndFrame();
+        if (render_interface.PopGpuTimings(timings)) {
+            for (const RenderInterface_GL3::GpuTiming& timing : timings)
+                result.gpu.values.push_back(timing.milliseconds);
+        }
+    }
+
+    document->Close();
+    context->Update();
+}
+
+void PrintText(const std::vector<DocumentResult>& results, const Options& options, bool gpu_timing) {
+    std::cout << fmt::format("{} frames after {} warmup frames, {}x{} @ {:.2f} dp{}\n", options.frames, options.warmup, options.width, options.height,
+        options.dp_ratio, gpu_timing ? "" : ", GPU timer queries not supported");
+    std::cout << fmt::format("{:<40} {:>10} {:>10} {:>10} {:>10} {:>8}\n", "document", "submit ms", "frame ms", "max ms", "gpu ms", "draws");
+    for (const DocumentResult& result : results) {
+        if (result.failed) {
+            std::cout << fmt::format("{:<40} failed to load\n", result.path);
+            continue;
+        }
+        std::cout << fmt::format("{:<40} {:>10.3f} {:>10.3f} {:>10.3f} {:>10} {:>8}\n", result.path, result.submit.Median(), result.frame.Median(),
+            result.frame.Max(), result.gpu.values.empty() ? "-" : fmt::format("{:.3f}", result.gpu.Median()), result.draw_calls);
+    }
+    std::cout << "Times are medians over all frames, max is the slowest frame.\n";
+}
+
+void PrintJson(const std::vector<DocumentResult>& results, const Options& options, bool gpu_timing) {
+    std::cout << "{\n";
+    std::cout << fmt::format("  \"frames\": {},\n  \"warmup\": {},\n  \"width\": {},\n  \"height\": {},\n  \"dp_ratio\": {:.3f},\n  \"gpu_timing\": {},\n",
+        options.frames, options.warmup, options.width, options.height, options.dp_ratio, gpu_timing);
+    std::cout << "  \"documents\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const DocumentResult& result = results[i];
+        std::cout << (i == 0 ? "\n" : ",\n");
+        std::cout << fmt::format("    {{\"path\": \"{}\", \"failed\": {}, \"submit_ms\": {:.4f}, \"frame_ms\": {:.4f}, \"max_frame_ms\": {:.4f}, "
+                                 "\"gpu_ms\": {:.4f}, \"draw_calls\": {}}}",
+            JsonEscape(result.path), result.failed, result.submit.Median(), result.frame.Median(), result.frame.Max(), result.gpu.Median(),
+            result.draw_calls);
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    std::vector<std::filesystem::path> paths = FindDocuments(options.directory, {".rml"});
+    if (paths.empty()) {
+        std::cerr << "No .rml files found in " << options.directory.string() << "\n";
+        return 1;
+    }
+
+    if (!glfwInit())
+        return 1;
+
+    // Same context as the editor, including the stencil buffer used for clipping transformed elements.
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_STENCIL_BITS, 8);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "RmlUi GL Benchmark", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Could not create an OpenGL 3.3 window\n";
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+
+    Rml::String renderer_message;
+    if (!RmlGL3::Initialize(&renderer_message)) {
+        std::cerr << renderer_message << "\n";
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 1;
+    }
+
+    std::vector<DocumentResult> results;
+    bool gpu_timing = false;
+    {
+        SystemInterface_GLFW system_interface;
+        system_interface.SetWindow(window);
+        RenderInterface_GL3 render_interface;
+        if (!render_interface) {
+            std::cerr << "Could not compile the shaders\n";
+            RmlGL3::Shutdown();
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return 1;
+        }
+        render_interface.SetViewport(options.width, options.height);
+        gpu_timing = render_interface.IsGpuTimingSupported();
+
+        Rml::SetSystemInterface(&system_interface);
+        Rml::SetRenderInterface(&render_interface);
+        Rml::Initialise();
+
+        Rml::Context* context = Rml::CreateContext("benchmark", Rml::Vector2i(options.width, options.height));
+        RenderInterface_GL3::RenderTargetHandle target = render_interface.CreateRenderTarget(options.width, options.height);
+        if (context && target) {
+            context->SetDensityIndependentPixelRatio(options.dp_ratio);
+            for (const std::string& font : options.fonts)
+                Rml::LoadFontFace(font, true);
+
+            for (const std::filesystem::path& path : paths) {
+                DocumentResult result;
+                result.path = path.lexically_relative(options.directory).generic_string();
+                BenchmarkDocument(context, render_interface, target, path, options, result);
+                results.push_back(result);
+            }
+        }
+
+        render_interface.ReleaseRenderTarget(target);
+        Rml::Shutdown();
+    }
+
+    RmlGL3::Shutdown();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    if (results.empty()) {
+        std::cerr << "Could not create the context or the render target\n";
+        return 1;
+    }
+    if (options.json)
+        PrintJson(results, options, gpu_timing);
+    else
+        PrintText(results, options, gpu_timing);
+
+    bool any_failed = std::any_of(results.begin(), results.end(), [](const DocumentResult& result) { return result.failed; });
+    return any_failed ? 2 : 0;
+}
@@ -0,0 +1,225 @@
+#include <RmlUi/Core.h>
+#include <RmlUi/Core/Factory.h>
+#include <RmlUi/Core/StyleSheetContainer.h>
+#include "RmlUi_Backend.h"
+#include "RmlUi_Renderer_Recording.h"
+#include "BenchmarkCommon.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+// Loads every .rml and .rcss file of a directory into a headless context and reports how long each stage takes.
+// Usage: RmlUi-Benchmark [--iterations N] [--width W] [--height H] [--dp-ratio R] [--font FILE]... [--preview] [--warm] [--json] [directory]
+
+struct Options : DocumentOptions {
+    int iterations = 20;
+    // Load documents from memory like the editor preview does, instead of from the file.
+    bool preview = false;
+    // Keep RmlUi's stylesheet and template caches between iterations.
+    bool warm = false;
+};
+
+struct DocumentResult {
+    std::string path;
+    bool is_stylesheet = false;
+    bool failed = false;
+    // Times in milliseconds. Style is derived as the first update minus a forced relayout.
+    Samples load, style, layout, update, render;
+    RenderInterface_Recording::Statistics render_statistics;
+};
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    const bool parsed = ParseArguments(argc, argv, [&](const std::string& arg, const char* value) {
+        if (arg == "--iterations" && value) {
+            options.iterations = std::max(1, std::atoi(value));
+            return 2;
+        }
+        if (arg == "--preview") {
+            options.preview = true;
+            return 1;
+        }
+        if (arg == "--warm") {
+            options.warm = true;
+            return 1;
+        }
+        return ParseDocumentOption(arg, value, options);
+    });
+    AddDefaultFont(options);
+    return parsed;
+}
+
+void BenchmarkStyleSheet(const std::filesystem::path& path, const Options& options, DocumentResult& result) {
+    for (int i = 0; i < options.iterations; i++) {
+        if (!options.warm)
+            Rml::Factory::ClearStyleSheetCache();
+
+        Timer timer;
+        Rml::SharedPtr<Rml::StyleSheetContainer> style_sheet = Rml::Factory::InstanceStyleSheetFile(path.generic_string());
+        result.load.values.push_back(timer.ElapsedMs());
+
+        if (!style_sheet) {
+            result.failed = true;
+            return;
+        }
+    }
+}
+
+void BenchmarkDocument(Rml::Context* context, const std::filesystem::path& path, const Options& options, DocumentResult& result) {
+    auto* render_interface = static_cast<RenderInterface_Recording*>(Backend::GetRenderInterface());
+
+    std::string source;
+    if (options.preview) {
+        std::ifstream ifs(path);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        source = ss.str();
+    }
+
+    for (int i = 0; i < options.iterations; i++) {
+        if (!options.warm) {
+            Rml::Factory::ClearStyleSheetCache();
+            Rml::Factory::ClearTemplateCache();
+        }
+
+        Timer load_timer;
+        Rml::ElementDocument* document = options.preview
+            ? context->LoadDocumentFromMemory(source, path.generic_string())
+            : context->LoadDocument(path.generic_string());
+        if (!document) {
+            result.failed = true;
+            return;
+        }
+        document->Show();
+        result.load.values.push_back(load_timer.ElapsedMs());
+
+        Timer update_timer;
+        context->Update();
+        const double update_ms = update_timer.ElapsedMs();
+
+        document->DirtyLayout();
+        Timer layout_timer;
+        context->Update();
+        const double layout_ms = layout_timer.ElapsedMs();
+
+        result.update.values.push_back(update_ms);
+        result.layout.values.push_back(layout_ms);
+        result.style.values.push_back(std::max(0.0, update_ms - layout_ms));
+
+        Timer render_timer;
+        Backend::BeginFrame();
+        context->Render();
+        Backend::PresentFrame();
+        result.render.values.push_back(render_timer.ElapsedMs());
+        result.render_statistics = render_interface->GetFrameStatistics();
+
+        document->Close();
+        context->Update();
+    }
+}
+
+void PrintText(const std::vector<DocumentResult>& results, const Options& options) {
+    std::cout << fmt::format("{} iterations, {}x{} @ {:.2f} dp, {}{}\n", options.iterations, options.width, options.height, options.dp_ratio,
+        options.preview ? "loaded from memory" : "loaded from file", options.warm ? ", warm caches" : "");
+    std::cout << fmt::format("{:<40} {:>10} {:>10} {:>10} {:>10} {:>10} {:>8} {:>9}\n", "document", "load ms", "style ms", "layout ms",
+        "update ms", "render ms", "draws", "vertices");
+    for (const DocumentResult& result : results) {
+        if (result.failed) {
+            std::cout << fmt::format("{:<40} failed to load\n", result.path);
+            continue;
+        }
+        if (result.is_stylesheet) {
+            std::cout << fmt::format("{:<40} {:>10.3f}\n", result.path, result.load.Median());
+            continue;
+        }
+        std::cout << fmt::format("{:<40} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>8} {:>9}\n", result.path, result.load.Median(),
+            result.style.Median(), result.layout.Median(), result.update.Median(), result.render.Median(), result.render_statistics.draw_calls,
+            result.render_statistics.vertices);
+    }
+    std::cout << "Times are medians over all iterations.\n";
+}
+
+void PrintJson(const std::vector<DocumentResult>& results, const Options& options) {
+    std::cout << "{\n";
+    std::cout << fmt::format("  \"iterations\": {},\n  \"width\": {},\n  \"height\": {},\n  \"dp_ratio\": {:.3f},\n  \"preview\": {},\n  \"warm\": {},\n",
+        options.iterations, options.width, options.height, options.dp_ratio, options.preview, options.warm);
+    std::cout << "  \"documents\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const DocumentResult& result = results[i];
+        std::cout << (i == 0 ? "\n" : ",\n");
+        std::cout << fmt::format("    {{\"path\": \"{}\", \"type\": \"{}\", \"failed\": {}, \"load_ms\": {}", JsonEscape(result.path),
+            result.is_stylesheet ? "rcss" : "rml", result.failed, JsonSamples(result.load));
+        if (!result.is_stylesheet) {
+            const RenderInterface_Recording::Statistics& stats = result.render_statistics;
+            std::cout << fmt::format(", \"style_ms\": {}, \"layout_ms\": {}, \"update_ms\": {}, \"render_ms\": {}", JsonSamples(result.style),
+                JsonSamples(result.layout), JsonSamples(result.update), JsonSamples(result.render));
+            std::cout << fmt::format(", \"draw_calls\": {}, \"compiled_draw_calls\": {}, \"vertices\": {}, \"indices\": {}, \"scissor_changes\": {}, "
+                                     "\"transform_changes\": {}",
+                stats.draw_calls, stats.compiled_draw_calls, stats.vertices, stats.indices, stats.scissor_changes, stats.transform_changes);
+        }
+        std::cout << "}";
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    std::vector<std::filesystem::path> paths = FindDocuments(options.directory, {".rml", ".rcss"});
+    if (paths.empty()) {
+        std::cerr << "No .rml or .rcss files found in " << options.directory.string() << "\n";
+        return 1;
+    }
+
+    if (!Backend::Initialize("RmlUi Benchmark", options.width, options.height, false))
+        return 1;
+
+    Rml::SetSystemInterface(Backend::GetSystemInterface());
+    Rml::SetRenderInterface(Backend::GetRenderInterface());
+    Rml::Initialise();
+
+    Rml::Context* context = Rml::CreateContext("benchmark", Rml::Vector2i(options.width, options.height));
+    if (!context) {
+        Rml::Shutdown();
+        Backend::Shutdown();
+        return 1;
+    }
+    Backend::ProcessEvents(context);
+    context->SetDensityIndependentPixelRatio(options.dp_ratio);
+
+    for (const std::string& font : options.fonts)
+        Rml::LoadFontFace(font, true);
+
+    // The command list is not needed, only the per-frame statistics.
+    static_cast<RenderInterface_Recording*>(Backend::GetRenderInterface())->SetRecordCommands(false);
+
+    std::vector<DocumentResult> results;
+    for (const std::filesystem::path& path : paths) {
+        DocumentResult result;
+        result.path = path.lexically_relative(options.directory).generic_string();
+        result.is_stylesheet = path.extension() == ".rcss";
+        if (result.is_stylesheet)
+            BenchmarkStyleSheet(path, options, result);
+        else
+            BenchmarkDocument(context, path, options, result);
+        results.push_back(result);
+    }
+
+    if (options.json)
+        PrintJson(results, options);
+    else
+        PrintText(results, options);
+
+    Rml::Shutdown();
+    Backend::Shutdown();
+
+    bool any_failed = std::any_of(results.begin(), results.end(), [](const DocumentResult& result) { return result.failed; });
+    return any_failed ? 2 : 0;
+}
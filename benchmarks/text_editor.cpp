@@ -0,0 +1,108 @@
+#include <imgui.h>
+#include "TextEditor.h"
+#include "BenchmarkCommon.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+// Pastes generated style sheets of a few megabytes into the text editor and reports how long the paste, undo and redo take.
+// Usage: TextEditor-Benchmark [--size MB] [--iterations N]
+
+struct Options {
+    double size_mb = 5.0;
+    int iterations = 5;
+};
+
+struct Case {
+    std::string name;
+    // Zero for a single minified line.
+    int line_length = 0;
+    // Paste into the middle of an existing document instead of an empty one.
+    bool into_document = false;
+};
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    return ParseArguments(argc, argv, [&](const std::string& arg, const char* value) {
+        if (arg == "--size" && value) {
+            options.size_mb = std::max(0.01, std::atof(value));
+            return 2;
+        }
+        if (arg == "--iterations" && value) {
+            options.iterations = std::max(1, std::atoi(value));
+            return 2;
+        }
+        return 0;
+    });
+}
+
+std::string GenerateStyleSheet(size_t size, int line_length) {
+    std::string result;
+    result.reserve(size + 128);
+    int column = 0;
+    for (int i = 0; result.size() < size; i++) {
+        const std::string rule = fmt::format(".button-{}:hover{{color:#{:06x};padding:{}dp {}dp;decorator:image(icons.tga);}}", i,
+            (i * 2654435761u) & 0xffffff, i % 16, i % 9);
+        result += rule;
+        column += (int)rule.size();
+        if (line_length > 0 && column >= line_length) {
+            result += '\n';
+            column = 0;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    // Paste() reads the clipboard through ImGui, nothing is rendered.
+    ImGui::CreateContext();
+
+    const size_t size = (size_t)(options.size_mb * 1024.0 * 1024.0);
+    const std::vector<Case> cases = {
+        { "single line", 0, false },
+        { "single line into document", 0, true },
+        { "80 column lines", 80, false },
+        { "80 column lines into document", 80, true },
+    };
+    const std::string document = GenerateStyleSheet(256 * 1024, 100);
+
+    std::cout << fmt::format("{:.2f} MB pasted, {} iterations\n", size / (1024.0 * 1024.0), options.iterations);
+    std::cout << fmt::format("{:<32} {:>10} {:>10} {:>10}\n", "case", "paste ms", "undo ms", "redo ms");
+    for (const Case& test : cases) {
+        const std::string text = GenerateStyleSheet(size, test.line_length);
+        ImGui::SetClipboardText(text.c_str());
+
+        double paste_ms = 0.0, undo_ms = 0.0, redo_ms = 0.0;
+        for (int i = 0; i < options.iterations; i++) {
+            TextEditor editor;
+            if (test.into_document) {
+                editor.SetText(document);
+                editor.SetCursorPosition(TextEditor::Coordinates(editor.GetTotalLines() / 2, 10));
+            }
+
+            Timer paste_timer;
+            editor.Paste();
+            paste_ms += paste_timer.ElapsedMs();
+
+            Timer undo_timer;
+            editor.Undo();
+            undo_ms += undo_timer.ElapsedMs();
+
+            Timer redo_timer;
+            editor.Redo();
+            redo_ms += redo_timer.ElapsedMs();
+        }
+        std::cout << fmt::format("{:<32} {:>10.3f} {:>10.3f} {:>10.3f}\n", test.name, paste_ms / options.iterations, undo_ms / options.iterations,
+            redo_ms / options.iterations);
+    }
+    std::cout << "Times are means over all iterations.\n";
+
+    ImGui::DestroyContext();
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "Completion.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <unordered_set>
+
+namespace {
+    constexpr size_t kMaxItems = 50;
+    // How far back a style sheet is read to tell whether the cursor is inside a rule.
+    constexpr int kMaxContextLines = 200;
+
+    const std::vector<std::string> kElements = {
+        "a", "body", "br", "button", "col", "colgroup", "div", "em", "form", "h1", "h2", "h3", "h4", "h5", "h6", "handle", "head",
+        "img", "input", "label", "link", "option", "p", "panel", "panels", "pre", "progress", "rml", "script", "select", "span", "strong",
+        "style", "svg", "tab", "table", "tabs", "tabset", "tbody", "td", "template", "textarea", "tfoot", "th", "thead", "title", "tr",
+    };
+
+    const std::vector<std::string> kAttributes = {
+        "autofocus", "checked", "class", "cols", "colspan", "data-alias-", "data-attr-", "data-attrif-", "data-checked", "data-class-",
+        "data-event-blur", "data-event-change", "data-event-click", "data-event-focus", "data-event-keydown", "data-event-mouseover",
+        "data-event-submit", "data-for", "data-if", "data-model", "data-rml", "data-style-", "data-value", "data-visible", "direction",
+        "disabled", "for", "height", "href", "id", "lang", "max", "maxlength", "min", "name", "onblur", "onchange", "onclick", "onfocus",
+        "onkeydown", "onkeyup", "onload", "onmousedown", "onmouseout", "onmouseover", "onmouseup", "onshow", "onsubmit", "onunload",
+        "orientation", "rect", "rows", "rowspan", "selected", "size", "span", "src", "step", "style", "tabindex", "template", "type",
+        "value", "width",
+    };
+
+    const std::vector<std::string> kProperties = {
+        "align-content", "align-items", "align-self", "animation", "backdrop-filter", "background-color", "border", "border-bottom",
+        "border-bottom-color", "border-bottom-left-radius", "border-bottom-right-radius", "border-bottom-width", "border-color",
+        "border-left", "border-left-color", "border-left-width", "border-radius", "border-right", "border-right-color",
+        "border-right-width", "border-top", "border-top-color", "border-top-left-radius", "border-top-right-radius", "border-top-width",
+        "border-width", "bottom", "box-shadow", "box-sizing", "caret-color", "clear", "clip", "color", "column-gap", "cursor",
+        "decorator", "display", "drag", "filter", "flex", "flex-basis", "flex-direction", "flex-flow", "flex-grow", "flex-shrink",
+        "flex-wrap", "float", "focus", "font-effect", "font-family", "font-size", "font-style", "font-weight", "gap", "height",
+        "image-color", "justify-content", "left", "letter-spacing", "line-height", "margin", "margin-bottom", "margin-left",
+        "margin-right", "margin-top", "mask-image", "max-height", "max-width", "min-height", "min-width", "nav", "nav-down", "nav-left",
+        "nav-right", "nav-up", "opacity", "overflow", "overflow-x", "overflow-y", "overscroll-behavior", "padding", "padding-bottom",
+        "padding-left", "padding-right", "padding-top", "perspective", "perspective-origin", "pointer-events", "position", "right",
+        "row-gap", "scrollbar-margin", "tab-index", "text-align", "text-decoration", "text-transform", "top", "transform",
+        "transform-origin", "transition", "vertical-align", "visibility", "white-space", "width", "word-break", "z-index",
+    };
+
+    bool IsWordChar(char c) {
+        return std::isalnum((unsigned char)c) || c == '-' || c == '_' || (unsigned char)c >= 0x80;
+    }
+
+    std::string ToLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return text;
+    }
+
+    // Name of the attribute whose quoted value starts at quote, empty if there is none.
+    std::string AttributeBefore(const std::string& line, size_t quote) {
+        if (quote == 0 || line[quote - 1] != '=')
+            return std::string();
+        size_t name_start = quote - 1;
+        while (name_start > 0 && IsWordChar(line[name_start - 1]))
+            name_start--;
+        return line.substr(name_start, quote - 1 - name_start);
+    }
+}
+
+Completion::Completion() {
+    m_elements = MakeWords(kElements);
+    m_attributes = MakeWords(kAttributes);
+    m_properties = MakeWords(kProperties);
+}
+
+void Completion::SetSelectors(const std::vector<std::string>& selectors) {
+    std::vector<std::string> classes, ids;
+    SplitSelectors(selectors, classes, ids);
+    m_classes = MakeWords(classes);
+    m_ids = MakeWords(ids);
+}
+
+void Completion::UpdateSelectors(const std::vector<std::string>& added, const std::vector<std::string>& removed) {
+    std::vector<std::string> added_classes, added_ids, removed_classes, removed_ids;
+    SplitSelectors(added, added_classes, added_ids);
+    SplitSelectors(removed, removed_classes, removed_ids);
+    UpdateWords(m_classes, added_classes, removed_classes);
+    UpdateWords(m_ids, added_ids, removed_ids);
+}
+
+void Completion::Complete(const TextEditor& editor, bool style_sheet, int& start, std::vector<std::string>& items) const {
+    const std::string line = editor.GetCurrentLineText();
+    int word_start = std::min(start, (int)line.size());
+    while (word_start > 0 && IsWordChar(line[word_start - 1]))
+        word_start--;
+
+    const size_t count = items.size();
+    if (style_sheet)
+        CompleteStyleSheet(editor, line.substr(0, start), word_start, items);
+    else
+        CompleteDocument(line.substr(0, start), word_start, items);
+    if (items.size() != count)
+        start = word_start;
+}
+
+Completion::Words Completion::MakeWords(const std::vector<std::string>& texts) {
+    Words words;
+    words.reserve(texts.size());
+    for (const std::string& text : texts)
+        words.push_back(Word{ ToLower(text), text });
+    std::sort(words.begin(), words.end(), [](const Word& a, const Word& b) { return a.key != b.key ? a.key < b.key : a.text < b.text; });
+    words.erase(std::unique(words.begin(), words.end(), [](const Word& a, const Word& b) { return a.text == b.text; }), words.end());
+    return words;
+}
+
+void Completion::SplitSelectors(const std::vector<std::string>& selectors, std::vector<std::string>& classes, std::vector<std::string>& ids) {
+    for (const std::string& selector : selectors) {
+        if (selector.size() < 2)
+            continue;
+        if (selector[0] == '.')
+            classes.push_back(selector.substr(1));
+        else if (selector[0] == '#')
+            ids.push_back(selector.substr(1));
+    }
+}
+
+void Completion::UpdateWords(Words& words, const std::vector<std::string>& added, const std::vector<std::string>& removed) {
+    if (!removed.empty()) {
+        const std::unordered_set<std::string> removed_set(removed.begin(), removed.end());
+        words.erase(std::remove_if(words.begin(), words.end(), [&](const Word& word) { return removed_set.count(word.text) != 0; }), words.end());
+    }
+    if (added.empty())
+        return;
+
+    auto less = [](const Word& a, const Word& b) { return a.key != b.key ? a.key < b.key : a.text < b.text; };
+    Words added_words = MakeWords(added);
+    const size_t middle = words.size();
+    words.insert(words.end(), std::make_move_iterator(added_words.begin()), std::make_move_iterator(added_words.end()));
+    std::inplace_merge(words.begin(), words.begin() + middle, words.end(), less);
+    words.erase(std::unique(words.begin(), words.end(), [](const Word& a, const Word& b) { return a.text == b.text; }), words.end());
+}
+
+void Completion::Find(const Words& words, const std::string& prefix, std::vector<std::string>& items) {
+    const std::string key = ToLower(prefix);
+    auto it = std::lower_bound(words.begin(), words.end(), key, [](const Word& word, const std::string& key) { return word.key < key; });
+    for (size_t found = 0; it != words.end() && found < kMaxItems && it->key.compare(0, key.size(), key) == 0; ++it, ++found)
+        items.push_back(it->text);
+}
+
+// The line ends at the cursor.
+void Completion::CompleteDocument(const std::string& line, int start, std::vector<std::string>& items) const {
+    const std::string prefix = line.substr(start);
+    const char before = start > 0 ? line[start - 1] : '\n';
+    if (before == '<') {
+        Find(m_elements, prefix, items);
+        return;
+    }
+
+    // Attributes and their values are only completed within a tag opened on the same line.
+    const size_t open = line.rfind('<');
+    const size_t close = line.rfind('>');
+    if (open == std::string::npos || (close != std::string::npos && close > open))
+        return;
+
+    char quote = 0;
+    size_t quote_position = 0;
+    for (size_t i = open; i < (size_t)start; i++) {
+        if (quote) {
+            if (line[i] == quote)
+                quote = 0;
+        }
+        else if (line[i] == '"' || line[i] == '\'') {
+            quote = line[i];
+            quote_position = i;
+        }
+    }
+
+    if (quote) {
+        const std::string attribute = AttributeBefore(line, quote_position);
+        if (attribute == "class")
+            Find(m_classes, prefix, items);
+        else if (attribute == "id")
+            Find(m_ids, prefix, items);
+    }
+    else if (!prefix.empty() && std::isspace((unsigned char)before))
+        Find(m_attributes, prefix, items);
+}
+
+// The line ends at the cursor.
+void Completion::CompleteStyleSheet(const TextEditor& editor, const std::string& line, int start, std::vector<std::string>& items) const {
+    const std::string prefix = line.substr(start);
+    const char before = start > 0 ? line[start - 1] : '\n';
+
+    // Inside a rule if the closest brace before the cursor opens one.
+    bool in_rule = false;
+    const size_t brace = line.find_last_of("{}", start);
+    if (brace != std::string::npos)
+        in_rule = line[brace] == '{';
+    else {
+        const int cursor_line = editor.GetCursorPosition().mLine;
+        for (int i = cursor_line - 1; i >= 0 && i >= cursor_line - kMaxContextLines; i--) {
+            const std::string text = editor.GetLineText(i);
+            const size_t previous = text.find_last_of("{}");
+            if (previous != std::string::npos) {
+                in_rule = text[previous] == '{';
+                break;
+            }
+        }
+    }
+
+    if (in_rule) {
+        // A property name starts the declaration, after that comes its value.
+        const size_t declaration = line.find_last_of(";{", start);
+        const size_t declaration_start = declaration == std::string::npos ? 0 : declaration + 1;
+        if (!prefix.empty() && line.find(':', declaration_start) >= (size_t)start)
+            Find(m_properties, prefix, items);
+        return;
+    }
+
+    if (before == '.')
+        Find(m_classes, prefix, items);
+    else if (before == '#')
+        Find(m_ids, prefix, items);
+    else if (!prefix.empty() && (std::isspace((unsigned char)before) || before == ',' || before == '>' || before == '+' || before == '~'))
+        Find(m_elements, prefix, items);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "TextEditor.h"
+#include <string>
+#include <vector>
+
+// Completions for RML documents and RCSS style sheets: elements, attributes, properties, and the classes and ids of the project.
+//
+// Every kind of word is kept in an array sorted by its lowercase spelling, a prefix is looked up with a binary search and the matches are
+// the run of words following it. The built-in words are sorted once, the classes and ids are updated with the selectors which changed.
+class Completion {
+public:
+    Completion();
+
+    // Replaces the classes and ids, each given with its leading '.' or '#'.
+    void SetSelectors(const std::vector<std::string>& selectors);
+    // Adds and removes classes and ids, see StyleIndex::TakeSelectorChanges(). Only the added words are sorted, they are merged into the
+    // sorted arrays.
+    void UpdateSelectors(const std::vector<std::string>& added, const std::vector<std::string>& removed);
+
+    // Completes the word before the cursor of the editor, see TextEditor::CompletionCallback.
+    void Complete(const TextEditor& editor, bool style_sheet, int& start, std::vector<std::string>& items) const;
+
+private:
+    struct Word {
+        std::string key;
+        std::string text;
+    };
+    using Words = std::vector<Word>;
+
+    static Words MakeWords(const std::vector<std::string>& texts);
+    static void SplitSelectors(const std::vector<std::string>& selectors, std::vector<std::string>& classes, std::vector<std::string>& ids);
+    static void UpdateWords(Words& words, const std::vector<std::string>& added, const std::vector<std::string>& removed);
+    static void Find(const Words& words, const std::string& prefix, std::vector<std::string>& items);
+
+    void CompleteDocument(const std::string& line, int start, std::vector<std::string>& items) const;
+    void CompleteStyleSheet(const TextEditor& editor, const std::string& line, int start, std::vector<std::string>& items) const;
+
+    Words m_elements;
+    Words m_attributes;
+    Words m_properties;
+    Words m_classes;
+    Words m_ids;
+};
@@ -0,0 +1,202 @@
+#include "FileWatcher.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    // A batch is handed over once no events arrived for a while, but at the latest after the maximum so that a long running
+    // operation still shows progress.
+    constexpr int kQuietMs = 100;
+    constexpr int kMaxBatchMs = 1000;
+
+    constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+FileWatcher::FileWatcher(std::function<void()> on_changes) : m_on_changes(std::move(on_changes)) {
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd < 0)
+        return;
+    if (pipe(m_wake_fds) != 0) {
+        close(m_inotify_fd);
+        m_inotify_fd = -1;
+        return;
+    }
+    m_thread = std::thread(&FileWatcher::Run, this);
+}
+
+FileWatcher::~FileWatcher() {
+    if (m_thread.joinable()) {
+        const char wake = 0;
+        (void)!write(m_wake_fds[1], &wake, 1);
+        m_thread.join();
+    }
+    for (int fd : { m_inotify_fd, m_wake_fds[0], m_wake_fds[1] }) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+void FileWatcher::Watch(const std::filesystem::path& directory) {
+    if (m_inotify_fd < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WatchedDirectory& watched = m_directories[directory.string()];
+    if (watched.count++ > 0)
+        return;
+
+    // Spellings of the same directory, e.g. with "..", a trailing separator or through a symbolic link, get the same descriptor.
+    watched.descriptor = inotify_add_watch(m_inotify_fd, directory.c_str(), kWatchMask);
+    if (watched.descriptor >= 0)
+        m_descriptors[watched.descriptor].push_back(directory.string());
+}
+
+void FileWatcher::Unwatch(const std::filesystem::path& directory) {
+    if (m_inotify_fd < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_directories.find(directory.string());
+    if (it == m_directories.end() || --it->second.count > 0)
+        return;
+
+    // The watch is shared by all spellings of the directory, it is only removed with the last of them.
+    auto descriptor = m_descriptors.find(it->second.descriptor);
+    if (descriptor != m_descriptors.end()) {
+        std::vector<std::string>& spellings = descriptor->second;
+        spellings.erase(std::remove(spellings.begin(), spellings.end(), it->first), spellings.end());
+        if (spellings.empty()) {
+            inotify_rm_watch(m_inotify_fd, descriptor->first);
+            m_descriptors.erase(descriptor);
+        }
+    }
+    m_directories.erase(it);
+}
+
+void FileWatcher::AddChange(const std::string& directory, const std::string& name) {
+    // Called with m_mutex locked. An empty name stands for the whole directory.
+    std::vector<std::string>& names = m_collecting[directory];
+    if (std::find(names.begin(), names.end(), name) == names.end())
+        names.push_back(name);
+}
+
+void FileWatcher::Run() {
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd fds[2] = { { m_inotify_fd, POLLIN, 0 }, { m_wake_fds[0], POLLIN, 0 } };
+
+    bool collecting = false;
+    std::chrono::steady_clock::time_point batch_start;
+
+    auto hand_over = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& [directory, names] : m_collecting) {
+                std::vector<std::string>& ready = m_ready[directory];
+                for (std::string& name : names) {
+                    if (std::find(ready.begin(), ready.end(), name) == ready.end())
+                        ready.push_back(std::move(name));
+                }
+            }
+            m_collecting.clear();
+        }
+        collecting = false;
+        if (m_on_changes)
+            m_on_changes();
+    };
+
+    while (true) {
+        int timeout = -1;
+        if (collecting) {
+            const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch_start).count();
+            if (elapsed_ms >= kMaxBatchMs) {
+                hand_over();
+                continue;
+            }
+            timeout = std::min<int>(kQuietMs, kMaxBatchMs - (int)elapsed_ms);
+        }
+
+        const int result = poll(fds, 2, timeout);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (fds[1].revents != 0)
+            return;
+        if (result == 0) {
+            hand_over();
+            continue;
+        }
+
+        const ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const char* ptr = buffer; ptr < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // The kernel dropped events, so anything may have changed.
+            if (event->mask & IN_Q_OVERFLOW) {
+                for (const auto& [directory, watched] : m_directories)
+                    AddChange(directory, "");
+                continue;
+            }
+
+            auto it = m_descriptors.find(event->wd);
+            if (it == m_descriptors.end())
+                continue;
+
+            const bool whole_directory = event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED);
+            for (const std::string& directory : it->second)
+                AddChange(directory, whole_directory || event->len == 0 ? std::string() : std::string(event->name));
+        }
+        if (!collecting) {
+            collecting = true;
+            batch_start = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+bool FileWatcher::PopChanges(std::vector<Change>& out_changes) {
+    out_changes.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [directory, names] : m_ready) {
+        Change change;
+        change.directory = directory;
+        if (std::find(names.begin(), names.end(), std::string()) == names.end())
+            change.names = std::move(names);
+        out_changes.push_back(std::move(change));
+    }
+    m_ready.clear();
+    return !out_changes.empty();
+}
+
+#else
+
+FileWatcher::FileWatcher(std::function<void()> on_changes) : m_on_changes(std::move(on_changes)) {}
+
+FileWatcher::~FileWatcher() {}
+
+void FileWatcher::Watch(const std::filesystem::path&) {}
+
+void FileWatcher::Unwatch(const std::filesystem::path&) {}
+
+void FileWatcher::AddChange(const std::string&, const std::string&) {}
+
+void FileWatcher::Run() {}
+
+bool FileWatcher::PopChanges(std::vector<Change>& out_changes) {
+    out_changes.clear();
+    return false;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches directories for changes to their entries on a background thread, using inotify on Linux. Elsewhere nothing is reported.
+//
+// Events arriving in quick succession, e.g. during a git checkout, are collected into a single batch. The callback is invoked from the
+// watcher thread once a batch is ready, the changes themselves are picked up on the main thread with PopChanges().
+class FileWatcher {
+public:
+    struct Change {
+        // Exactly as passed to Watch().
+        std::filesystem::path directory;
+        // Names of the changed entries, each listed once. Empty if events were lost and anything in the directory may have changed.
+        std::vector<std::string> names;
+    };
+
+    explicit FileWatcher(std::function<void()> on_changes);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Directories are reference counted, every call to Watch() needs a matching call to Unwatch(). A directory watched under several
+    // spellings has its changes reported under each of them.
+    void Watch(const std::filesystem::path& directory);
+    void Unwatch(const std::filesystem::path& directory);
+
+    // Moves the changes collected since the last call into out_changes. Returns false if there were none.
+    bool PopChanges(std::vector<Change>& out_changes);
+
+private:
+    struct WatchedDirectory {
+        int descriptor = -1;
+        int count = 0;
+    };
+
+    void Run();
+    void AddChange(const std::string& directory, const std::string& name);
+
+    std::function<void()> m_on_changes;
+    int m_inotify_fd = -1;
+    // Written to when the watcher thread should stop.
+    int m_wake_fds[2] = { -1, -1 };
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::map<std::string, WatchedDirectory> m_directories;
+    // The spellings sharing each inotify watch.
+    std::map<int, std::vector<std::string>> m_descriptors;
+    // The batch being collected by the watcher thread, and the batches ready for the main thread.
+    std::map<std::string, std::vector<std::string>> m_collecting;
+    std::map<std::string, std::vector<std::string>> m_ready;
+};
@@ -0,0 +1,249 @@
+#include <imgui.h>
+#include "FindPanel.h"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+
+namespace {
+    // The worker hands over its matches after each chunk, which ends at a new line, or once it found this many within a chunk.
+    constexpr size_t kChunkSize = 256 * 1024;
+    constexpr size_t kBatchSize = 4096;
+}
+
+FindPanel::FindPanel(std::function<void()> on_results) : m_on_results(std::move(on_results)) {}
+
+FindPanel::~FindPanel() {
+    StopSearch();
+    JoinStoppedSearches(true);
+}
+
+void FindPanel::Open(bool replace) {
+    if (!m_open)
+        m_outdated = true;
+    m_open = true;
+    m_show_replace = replace;
+    m_focus_query = true;
+}
+
+bool FindPanel::Draw(TextEditor& editor) {
+    if (!m_open)
+        return false;
+
+    if (editor.IsTextChanged())
+        m_outdated = true;
+    PollResults(editor);
+
+    bool replaced = false;
+    const float input_width = std::min(320.0f, ImGui::GetContentRegionAvail().x * 0.5f);
+
+    if (m_focus_query) {
+        ImGui::SetKeyboardFocusHere();
+        m_focus_query = false;
+    }
+    ImGui::SetNextItemWidth(input_width);
+    // Enter moves to the next match and keeps the focus in the query, Shift+Enter to the previous one.
+    const bool enter = ImGui::InputTextWithHint("##find", "Find", m_query, sizeof(m_query), ImGuiInputTextFlags_EnterReturnsTrue);
+    if (enter)
+        ImGui::SetKeyboardFocusHere(-1);
+    if (ImGui::IsItemEdited())
+        m_outdated = true;
+    bool find_next = enter && !ImGui::GetIO().KeyShift;
+    bool find_previous = enter && ImGui::GetIO().KeyShift;
+
+    ImGui::SameLine();
+    m_outdated |= ImGui::Checkbox("Aa", &m_options.case_sensitive);
+    ImGui::SameLine();
+    m_outdated |= ImGui::Checkbox("Word", &m_options.whole_word);
+    ImGui::SameLine();
+    m_outdated |= ImGui::Checkbox(".*", &m_options.regex);
+    ImGui::SameLine();
+    find_previous |= ImGui::ArrowButton("##previous", ImGuiDir_Up);
+    ImGui::SameLine();
+    find_next |= ImGui::ArrowButton("##next", ImGuiDir_Down);
+    ImGui::SameLine();
+
+    if (m_outdated)
+        StartSearch(editor);
+
+    const size_t match_count = editor.GetHighlights().size();
+    if (!m_error.empty())
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", m_error.c_str());
+    else if (m_query[0] == '\0')
+        ImGui::TextDisabled("No query");
+    else if (m_searching)
+        ImGui::TextDisabled("%s", fmt::format("{} matches...", match_count).c_str());
+    else if (match_count == 0)
+        ImGui::TextDisabled("No results");
+    else {
+        int selected = editor.GetSelectedHighlight();
+        if (selected >= 0)
+            ImGui::Text("%s", fmt::format("{} of {}", selected + 1, match_count).c_str());
+        else
+            ImGui::Text("%s", fmt::format("{} matches", match_count).c_str());
+    }
+
+    ImGui::SameLine();
+    bool close = ImGui::SmallButton("x");
+
+    if (find_previous)
+        editor.SelectNextHighlight(true);
+    else if (find_next)
+        editor.SelectNextHighlight();
+
+    if (m_show_replace) {
+        ImGui::SetNextItemWidth(input_width);
+        ImGui::InputTextWithHint("##replace", "Replace", m_replacement, sizeof(m_replacement));
+        ImGui::SameLine();
+
+        // The highlights are only valid for the current text once the search is done.
+        ImGui::BeginDisabled(m_searching || !m_error.empty() || match_count == 0 || editor.IsReadOnly());
+        if (ImGui::Button("Replace")) {
+            int selected = editor.GetSelectedHighlight();
+            if (selected >= 0) {
+                editor.ReplaceHighlights(m_replacement, selected, 1);
+                m_select_after_search = true;
+                m_outdated = true;
+                replaced = true;
+            }
+            else
+                editor.SelectNextHighlight();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Replace All")) {
+            editor.ReplaceHighlights(m_replacement);
+            m_outdated = true;
+            replaced = true;
+        }
+        ImGui::EndDisabled();
+    }
+
+    if (close || (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImGui::IsKeyPressed(ImGuiKey_Escape)))
+        Close(editor);
+
+    return replaced;
+}
+
+void FindPanel::Close(TextEditor& editor) {
+    StopSearch();
+    editor.ClearHighlights();
+    m_open = false;
+    m_select_after_search = false;
+}
+
+void FindPanel::StartSearch(TextEditor& editor) {
+    StopSearch();
+    editor.ClearHighlights();
+    m_outdated = false;
+    m_error.clear();
+
+    if (!m_search.SetPattern(m_query, m_options, &m_error) || m_search.IsEmpty())
+        return;
+
+    m_running = std::make_unique<Search>();
+    m_running->thread = std::thread(&FindPanel::Run, this, std::ref(*m_running), editor.GetText(), m_search);
+    m_searching = true;
+}
+
+void FindPanel::StopSearch() {
+    if (m_running) {
+        m_running->cancel = true;
+        m_stopped.push_back(std::move(m_running));
+    }
+    m_searching = false;
+    JoinStoppedSearches(false);
+}
+
+void FindPanel::JoinStoppedSearches(bool wait) {
+    auto it = std::remove_if(m_stopped.begin(), m_stopped.end(), [wait](const std::unique_ptr<Search>& search) {
+        if (!wait && !search->done)
+            return false;
+        search->thread.join();
+        return true;
+    });
+    m_stopped.erase(it, m_stopped.end());
+}
+
+void FindPanel::Run(Search& state, std::string text, TextSearch search) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    // Line of the last match, and where that line starts.
+    int line = 0;
+    const char* line_start = begin;
+
+    TextEditor::TextRanges ranges;
+    auto hand_over = [&] {
+        if (ranges.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.batch.insert(state.batch.end(), ranges.begin(), ranges.end());
+        }
+        ranges.clear();
+        if (m_on_results)
+            m_on_results();
+    };
+
+    TextSearch::Cursor cursor;
+    cursor.cancel = &state.cancel;
+    const char* chunk_begin = begin;
+    while (chunk_begin < end && !state.cancel) {
+        const char* chunk_end = begin + std::min(text.size(), (size_t)(chunk_begin - begin) + kChunkSize);
+        if (chunk_end < end) {
+            const char* new_line = (const char*)std::memchr(chunk_end, '\n', end - chunk_end);
+            chunk_end = new_line ? new_line + 1 : end;
+        }
+
+        TextSearch::Match match;
+        const char* from = chunk_begin;
+        while (from < chunk_end && search.Find(begin, chunk_end, from, match, &cursor)) {
+            const char* match_begin = begin + match.offset;
+            for (const char* p = line_start; (p = (const char*)std::memchr(p, '\n', match_begin - p)) != nullptr; line_start = ++p)
+                line++;
+
+            TextEditor::TextRange range;
+            range.mLine = line;
+            range.mStart = (int)(match_begin - line_start);
+            range.mEnd = range.mStart + (int)match.length;
+            ranges.push_back(range);
+            from = match_begin + match.length;
+
+            // A minified file is a single chunk.
+            if (state.cancel)
+                break;
+            if (ranges.size() >= kBatchSize)
+                hand_over();
+        }
+        chunk_begin = chunk_end;
+        hand_over();
+    }
+
+    state.done = true;
+    if (m_on_results)
+        m_on_results();
+}
+
+void FindPanel::PollResults(TextEditor& editor) {
+    JoinStoppedSearches(false);
+    if (!m_running)
+        return;
+
+    // Read before the batch, the last matches are handed over before the search is done.
+    const bool done = m_running->done;
+    TextEditor::TextRanges ranges;
+    {
+        std::lock_guard<std::mutex> lock(m_running->mutex);
+        ranges.swap(m_running->batch);
+    }
+    if (!ranges.empty())
+        editor.AddHighlights(ranges);
+
+    if (done) {
+        m_running->thread.join();
+        m_running.reset();
+        m_searching = false;
+        if (m_select_after_search)
+            editor.SelectNextHighlight();
+        m_select_after_search = false;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "TextSearch.h"
+#include "TextEditor.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Find and replace bar of a text editor.
+//
+// The search runs on a worker thread over a snapshot of the text, taken whenever the query, the options or the text change. Matches are
+// handed over in batches while the search is running and shown as highlights of the editor, which only draws those on visible lines. An
+// outdated search is cancelled, which its worker notices even within a long line, and joined once it finished instead of waiting for it
+// on the UI thread. Replacing is disabled until the highlights match the text again.
+class FindPanel {
+public:
+    // on_results is called from the worker thread whenever a batch of matches is ready.
+    explicit FindPanel(std::function<void()> on_results);
+    ~FindPanel();
+
+    FindPanel(const FindPanel&) = delete;
+    FindPanel& operator=(const FindPanel&) = delete;
+
+    void Open(bool replace);
+    bool IsOpen() const { return m_open; }
+
+    // Draws the panel above the editor, call before TextEditor::Render(). Returns true if text was replaced.
+    bool Draw(TextEditor& editor);
+
+private:
+    // What the UI thread and the worker of one search share.
+    struct Search {
+        std::thread thread;
+        std::atomic<bool> cancel = false;
+        std::atomic<bool> done = false;
+        std::mutex mutex;
+        TextEditor::TextRanges batch;
+    };
+
+    void StartSearch(TextEditor& editor);
+    void StopSearch();
+    void JoinStoppedSearches(bool wait);
+    void Run(Search& state, std::string text, TextSearch search);
+    void PollResults(TextEditor& editor);
+    void Close(TextEditor& editor);
+
+    std::function<void()> m_on_results;
+    bool m_open = false;
+    bool m_show_replace = false;
+    bool m_focus_query = false;
+    // Set when the search has to be restarted with the current query and options.
+    bool m_outdated = false;
+    // Moves to the match after the cursor once the search restarted by a replace is done.
+    bool m_select_after_search = false;
+    char m_query[256] = {};
+    char m_replacement[256] = {};
+    TextSearch::Options m_options;
+    TextSearch m_search;
+    std::string m_error;
+
+    std::unique_ptr<Search> m_running;
+    // Cancelled searches whose workers may still be running.
+    std::vector<std::unique_ptr<Search>> m_stopped;
+    bool m_searching = false;
+};
@@ -0,0 +1,423 @@
+#include <imgui.h>
+#include "FolderSearch.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fmt/format.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FOLDER_SEARCH_MMAP
+#endif
+
+namespace {
+    constexpr unsigned int kMaxWorkers = 8;
+    // Large files are scanned in chunks ending at a new line. Cancelling is also noticed after every match and within long lines.
+    constexpr size_t kChunkSize = 1024 * 1024;
+    // Files with a null byte in their first bytes are taken for binary files and skipped.
+    constexpr size_t kBinaryCheckSize = 8 * 1024;
+    // The search stops collecting matches after this many, a query matching everything would otherwise fill up the memory.
+    constexpr size_t kMaxMatches = 20000;
+    // Characters of the line shown before and after a match.
+    constexpr int kPreviewBefore = 40;
+    constexpr int kPreviewAfter = 80;
+}
+
+FolderSearch::FolderSearch(std::function<void()> on_results) : m_on_results(std::move(on_results)) {}
+
+FolderSearch::~FolderSearch() {
+    StopSearch();
+    JoinStoppedSearches(true);
+}
+
+void FolderSearch::Open(const std::string& folder) {
+    if (!m_open || folder != m_folder)
+        m_outdated = true;
+    m_open = true;
+    m_folder = folder;
+    m_focus_query = true;
+}
+
+bool FolderSearch::Draw(Location& location) {
+    if (!m_open)
+        return false;
+
+    PollResults();
+
+    bool activated = false;
+    ImGui::SetNextWindowSize(ImVec2(640, 480), ImGuiCond_FirstUseEver);
+    if (m_focus_query)
+        ImGui::SetNextWindowFocus();
+    if (ImGui::Begin("Find in Folder", &m_open)) {
+        ImGui::TextDisabled("%s", m_folder.c_str());
+
+        if (m_focus_query) {
+            ImGui::SetKeyboardFocusHere();
+            m_focus_query = false;
+        }
+        ImGui::SetNextItemWidth(std::max(120.0f, ImGui::GetContentRegionAvail().x - 200.0f));
+        ImGui::InputTextWithHint("##query", "Find", m_query, sizeof(m_query));
+        m_outdated |= ImGui::IsItemEdited();
+        ImGui::SameLine();
+        m_outdated |= ImGui::Checkbox("Aa", &m_options.case_sensitive);
+        ImGui::SameLine();
+        m_outdated |= ImGui::Checkbox("Word", &m_options.whole_word);
+        ImGui::SameLine();
+        m_outdated |= ImGui::Checkbox(".*", &m_options.regex);
+
+        ImGui::SetNextItemWidth(std::max(120.0f, ImGui::GetContentRegionAvail().x - 200.0f));
+        ImGui::InputTextWithHint("##filter", "Extensions, e.g. .rml .rcss", m_filter, sizeof(m_filter));
+        m_outdated |= ImGui::IsItemEdited();
+
+        if (m_outdated)
+            StartSearch();
+
+        const size_t match_count = std::min(m_match_count, kMaxMatches);
+        if (!m_error.empty())
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", m_error.c_str());
+        else if (m_query[0] == '\0')
+            ImGui::TextDisabled("No query");
+        else {
+            std::string status = fmt::format("{} matches in {} files, {} files searched", match_count, m_results.size(), m_files_scanned);
+            if (m_limited)
+                status += fmt::format(", stopped after {} matches", kMaxMatches);
+            else if (m_searching)
+                status += "...";
+            ImGui::TextDisabled("%s", status.c_str());
+        }
+
+        ImGui::Separator();
+        ImGui::BeginChild("##results");
+        const float line_height = ImGui::GetTextLineHeightWithSpacing();
+        ImGuiListClipper clipper;
+        clipper.Begin((int)m_rows.size(), line_height);
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const FileResult& file = m_results[m_rows[row].first];
+                if (m_rows[row].second < 0) {
+                    ImGui::TextUnformatted(file.display_name.c_str());
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("%s", fmt::format("({})", file.matches.size()).c_str());
+                    continue;
+                }
+
+                // The preview may contain "##", so it is drawn over an unlabeled selectable.
+                const LineMatch& match = file.matches[m_rows[row].second];
+                const std::string prefix = fmt::format("{:>6}  ", match.line + 1);
+                const ImVec2 position = ImGui::GetCursorScreenPos();
+                ImGui::PushID(row);
+                if (ImGui::Selectable("##match")) {
+                    location.path = file.path;
+                    location.line = match.line;
+                    location.start = match.start;
+                    location.end = match.end;
+                    activated = true;
+                }
+                ImGui::PopID();
+
+                const char* preview = match.preview.c_str();
+                const float match_x = position.x + ImGui::CalcTextSize(prefix.c_str()).x +
+                    ImGui::CalcTextSize(preview, preview + match.preview_start).x;
+                const float match_width = ImGui::CalcTextSize(preview + match.preview_start, preview + match.preview_end).x;
+                ImGui::GetWindowDrawList()->AddRectFilled(ImVec2(match_x, position.y),
+                    ImVec2(match_x + match_width, position.y + ImGui::GetTextLineHeight()), IM_COL32(255, 160, 0, 96));
+
+                ImGui::SetCursorScreenPos(position);
+                ImGui::TextDisabled("%s", prefix.c_str());
+                ImGui::SameLine(0.0f, 0.0f);
+                ImGui::TextUnformatted(preview, preview + match.preview.size());
+            }
+        }
+        ImGui::EndChild();
+    }
+    ImGui::End();
+
+    if (!m_open)
+        StopSearch();
+    return activated;
+}
+
+void FolderSearch::StartSearch() {
+    StopSearch();
+    m_outdated = false;
+    m_error.clear();
+    m_results.clear();
+    m_rows.clear();
+    m_limited = false;
+    m_match_count = 0;
+    m_files_scanned = 0;
+
+    if (!m_search.SetPattern(m_query, m_options, &m_error) || m_search.IsEmpty())
+        return;
+    const std::filesystem::path folder = std::filesystem::u8path(m_folder);
+    std::error_code error;
+    if (!std::filesystem::is_directory(folder, error)) {
+        m_error = fmt::format("{} is not a folder", m_folder);
+        return;
+    }
+
+    m_running = std::make_unique<Search>();
+    Search& search = *m_running;
+    search.text_search = m_search;
+    search.folder = folder;
+    std::istringstream filter(m_filter);
+    std::string extension;
+    while (filter >> extension) {
+        extension.erase(0, extension.find_first_not_of("*"));
+        if (extension.empty())
+            continue;
+        if (extension[0] != '.')
+            extension.insert(extension.begin(), '.');
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        search.extensions.push_back(extension);
+    }
+
+    const unsigned int worker_count = std::clamp(std::thread::hardware_concurrency(), 2u, kMaxWorkers);
+    for (unsigned int i = 0; i < worker_count; i++)
+        search.queues.push_back(std::make_unique<WorkQueue>());
+    PushTask(search, 0, Task{ search.folder, true });
+
+    m_searching = true;
+    search.running_workers = (int)worker_count;
+    for (unsigned int i = 0; i < worker_count; i++)
+        search.threads.emplace_back(&FolderSearch::Work, this, std::ref(search), (size_t)i);
+}
+
+void FolderSearch::StopSearch() {
+    if (m_running) {
+        m_running->cancel = true;
+        m_stopped.push_back(std::move(m_running));
+    }
+    m_searching = false;
+    JoinStoppedSearches(false);
+}
+
+void FolderSearch::JoinStoppedSearches(bool wait) {
+    auto it = std::remove_if(m_stopped.begin(), m_stopped.end(), [wait](const std::unique_ptr<Search>& search) {
+        if (!wait && search->running_workers != 0)
+            return false;
+        for (std::thread& thread : search->threads)
+            thread.join();
+        return true;
+    });
+    m_stopped.erase(it, m_stopped.end());
+}
+
+void FolderSearch::Work(Search& search, size_t index) {
+    Task task;
+    while (!search.cancel) {
+        if (!PopTask(search, index, task)) {
+            // Another worker may still be listing a directory.
+            if (search.pending_tasks == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        if (task.directory)
+            ListDirectory(search, index, task.path);
+        else
+            SearchFile(search, task.path);
+        search.pending_tasks--;
+    }
+
+    if (--search.running_workers == 0 && m_on_results)
+        m_on_results();
+}
+
+bool FolderSearch::PopTask(Search& search, size_t index, Task& task) {
+    {
+        WorkQueue& own = *search.queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < search.queues.size(); i++) {
+        WorkQueue& other = *search.queues[(index + i) % search.queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void FolderSearch::PushTask(Search& search, size_t index, Task task) {
+    search.pending_tasks++;
+    WorkQueue& queue = *search.queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+}
+
+void FolderSearch::ListDirectory(Search& search, size_t index, const std::filesystem::path& directory) {
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        const std::filesystem::directory_entry& entry = *it;
+        // Skips .git and the like. Symbolic links aren't followed, they could lead back up the tree.
+        const std::string name = entry.path().filename().string();
+        std::error_code entry_error;
+        if (name.empty() || name[0] == '.' || entry.is_symlink(entry_error))
+            continue;
+        if (entry.is_directory(entry_error))
+            PushTask(search, index, Task{ entry.path(), true });
+        else if (entry.is_regular_file(entry_error) && MatchesFilter(search, entry.path()))
+            PushTask(search, index, Task{ entry.path(), false });
+    }
+}
+
+bool FolderSearch::MatchesFilter(const Search& search, const std::filesystem::path& path) const {
+    if (search.extensions.empty())
+        return true;
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return std::find(search.extensions.begin(), search.extensions.end(), extension) != search.extensions.end();
+}
+
+void FolderSearch::SearchFile(Search& search, const std::filesystem::path& path) {
+    if (search.match_count > kMaxMatches)
+        return;
+
+    FileResult result;
+#ifdef FOLDER_SEARCH_MMAP
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        const size_t size = (size_t)info.st_size;
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            SearchText(search, (const char*)data, (const char*)data + size, result);
+            munmap(data, size);
+        }
+    }
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const std::string text = ss.str();
+    SearchText(search, text.data(), text.data() + text.size(), result);
+#endif
+    search.files_scanned++;
+
+    if (result.matches.empty())
+        return;
+    result.path = path.string();
+    result.display_name = path.lexically_relative(search.folder).generic_string();
+    {
+        std::lock_guard<std::mutex> lock(search.mutex);
+        search.batch.push_back(std::move(result));
+    }
+    if (m_on_results)
+        m_on_results();
+}
+
+void FolderSearch::SearchText(Search& search, const char* begin, const char* end, FileResult& result) {
+    if (std::memchr(begin, '\0', std::min((size_t)(end - begin), kBinaryCheckSize)))
+        return;
+
+    // Line of the last match, and where that line starts.
+    int line = 0;
+    const char* line_start = begin;
+
+    TextSearch::Cursor cursor;
+    cursor.cancel = &search.cancel;
+    const char* chunk_begin = begin;
+    while (chunk_begin < end && !search.cancel) {
+        const char* chunk_end = chunk_begin + std::min((size_t)(end - chunk_begin), kChunkSize);
+        if (chunk_end < end) {
+            const char* new_line = (const char*)std::memchr(chunk_end, '\n', end - chunk_end);
+            chunk_end = new_line ? new_line + 1 : end;
+        }
+
+        TextSearch::Match found;
+        const char* from = chunk_begin;
+        while (from < chunk_end && !search.cancel && search.text_search.Find(begin, chunk_end, from, found, &cursor)) {
+            const char* match_begin = begin + found.offset;
+            const char* match_end = match_begin + found.length;
+            for (const char* p = line_start; (p = (const char*)std::memchr(p, '\n', match_begin - p)) != nullptr; line_start = ++p)
+                line++;
+            from = match_end;
+
+            if (search.match_count++ >= kMaxMatches)
+                return;
+
+            const char* line_end = (const char*)std::memchr(match_end, '\n', end - match_end);
+            if (!line_end)
+                line_end = end;
+            if (line_end > line_start && line_end[-1] == '\r')
+                line_end--;
+
+            LineMatch match;
+            match.line = line;
+            match.start = (int)(match_begin - line_start);
+            match.end = (int)(match_end - line_start);
+
+            const char* preview_begin = std::max(line_start, match_begin - kPreviewBefore);
+            const char* preview_end = std::min(line_end, std::max(match_end, match_begin + kPreviewAfter));
+            if (preview_begin == line_start) {
+                while (preview_begin < match_begin && (*preview_begin == ' ' || *preview_begin == '\t'))
+                    preview_begin++;
+            }
+            match.preview.assign(preview_begin, preview_end);
+            std::replace(match.preview.begin(), match.preview.end(), '\t', ' ');
+            match.preview_start = (int)(match_begin - preview_begin);
+            match.preview_end = (int)(std::min(match_end, preview_end) - preview_begin);
+            result.matches.push_back(std::move(match));
+        }
+        chunk_begin = chunk_end;
+    }
+}
+
+void FolderSearch::PollResults() {
+    JoinStoppedSearches(false);
+    if (!m_running)
+        return;
+
+    // The workers hand over their last batch before they exit.
+    Search& search = *m_running;
+    const bool done = search.running_workers == 0;
+    std::vector<FileResult> batch;
+    {
+        std::lock_guard<std::mutex> lock(search.mutex);
+        batch.swap(search.batch);
+    }
+    for (FileResult& result : batch) {
+        const int file = (int)m_results.size();
+        m_rows.emplace_back(file, -1);
+        for (int i = 0; i < (int)result.matches.size(); i++)
+            m_rows.emplace_back(file, i);
+        m_results.push_back(std::move(result));
+    }
+    m_match_count = search.match_count;
+    m_files_scanned = search.files_scanned;
+    m_limited = m_match_count > kMaxMatches;
+
+    if (done) {
+        for (std::thread& thread : search.threads)
+            thread.join();
+        m_running.reset();
+        m_searching = false;
+        // The files arrived in the order the workers finished them, the final list is sorted by path.
+        std::sort(m_results.begin(), m_results.end(), [](const FileResult& a, const FileResult& b) { return a.display_name < b.display_name; });
+        m_rows.clear();
+        for (int file = 0; file < (int)m_results.size(); file++) {
+            m_rows.emplace_back(file, -1);
+            for (int i = 0; i < (int)m_results[file].matches.size(); i++)
+                m_rows.emplace_back(file, i);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "TextSearch.h"
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Find in the files of a folder, shown as a window listing the matches by file.
+//
+// The folder is walked and searched by a pool of threads. Every worker has its own queue of directories and files, it reads its queue
+// from the back and takes from the front of the others' queues when its own is empty, so a deep subtree doesn't keep one thread busy while
+// the others idle. Files are memory mapped where possible and scanned with TextSearch. The matches of each file are handed over as soon as
+// the file is done, and the search is cancelled and restarted whenever the query, the options or the folder change. A cancelled search
+// keeps its own state and is joined once its workers exited, so typing a query never waits for them on the UI thread.
+class FolderSearch {
+public:
+    struct Location {
+        std::string path;
+        // Zero based, the characters of the match within the line.
+        int line = 0;
+        int start = 0;
+        int end = 0;
+    };
+
+    // on_results is called from the worker threads whenever matches are ready or the search is done.
+    explicit FolderSearch(std::function<void()> on_results);
+    ~FolderSearch();
+
+    FolderSearch(const FolderSearch&) = delete;
+    FolderSearch& operator=(const FolderSearch&) = delete;
+
+    void Open(const std::string& folder);
+    bool IsOpen() const { return m_open; }
+    const std::string& GetFolder() const { return m_folder; }
+
+    // Draws the window. Returns true and sets location if a match was activated.
+    bool Draw(Location& location);
+
+private:
+    struct LineMatch {
+        int line = 0;
+        int start = 0;
+        int end = 0;
+        // The line around the match, shortened if it is long.
+        std::string preview;
+        int preview_start = 0;
+        int preview_end = 0;
+    };
+    struct FileResult {
+        std::string path;
+        // Relative to the folder.
+        std::string display_name;
+        std::vector<LineMatch> matches;
+    };
+    struct Task {
+        std::filesystem::path path;
+        bool directory = false;
+    };
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Everything the workers of one search use. The pattern, the extensions and the folder are copies taken when it started, the window
+    // may change them while the workers are running.
+    struct Search {
+        TextSearch text_search;
+        std::vector<std::string> extensions;
+        std::filesystem::path folder;
+
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        // Tasks which are queued or being worked on, the workers exit once there are none.
+        std::atomic<int> pending_tasks = 0;
+        std::atomic<int> running_workers = 0;
+        std::atomic<bool> cancel = false;
+        std::atomic<size_t> match_count = 0;
+        std::atomic<size_t> files_scanned = 0;
+
+        std::mutex mutex;
+        std::vector<FileResult> batch;
+    };
+
+    void StartSearch();
+    void StopSearch();
+    void JoinStoppedSearches(bool wait);
+    void Work(Search& search, size_t index);
+    bool PopTask(Search& search, size_t index, Task& task);
+    void PushTask(Search& search, size_t index, Task task);
+    void ListDirectory(Search& search, size_t index, const std::filesystem::path& directory);
+    void SearchFile(Search& search, const std::filesystem::path& path);
+    void SearchText(Search& search, const char* begin, const char* end, FileResult& result);
+    bool MatchesFilter(const Search& search, const std::filesystem::path& path) const;
+    void PollResults();
+
+    std::function<void()> m_on_results;
+    bool m_open = false;
+    bool m_focus_query = false;
+    bool m_outdated = false;
+    std::string m_folder;
+    char m_query[256] = {};
+    char m_filter[256] = ".rml .rcss";
+    TextSearch::Options m_options;
+    TextSearch m_search;
+    std::string m_error;
+
+    std::unique_ptr<Search> m_running;
+    // Cancelled searches whose workers may still be running.
+    std::vector<std::unique_ptr<Search>> m_stopped;
+    bool m_searching = false;
+    bool m_limited = false;
+
+    // Results in the order the files were done, and the rows of the list: the file and the match within it, -1 for the file itself.
+    std::vector<FileResult> m_results;
+    std::vector<std::pair<int, int>> m_rows;
+    size_t m_match_count = 0;
+    size_t m_files_scanned = 0;
+};
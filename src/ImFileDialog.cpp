@@ -4,6 +4,11 @@
 #include "ImFileDialog.h"
 
 #include <fstream>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 #include <algorithm>
 #include <sys/stat.h>
 #define IMGUI_DEFINE_MATH_OPERATORS
@@ -12,6 +17,8 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -28,39 +35,294 @@
 #define ICON_SIZE ImGui::GetFont()->FontSize + 3
 #define GUI_ELEMENT_SIZE std::max(GImGui->FontSize + 10.f, 24.f)
 #define DEFAULT_ICON_SIZE 32
+#define PREVIEW_SIZE 256
+#define PREVIEW_CACHE_MAX_AGE 30 // days
 #define PI 3.141592f
 
 namespace ifd {
 	static const char* GetDefaultFolderIcon();
 	static const char* GetDefaultFileIcon();
 
+	// compares runs of digits by their value, so that "file2" comes before "file10"
+	static int NaturalCompare(const std::string& left, const std::string& right)
+	{
+		size_t l = 0, r = 0;
+		while (l < left.size() && r < right.size()) {
+			if (isdigit(static_cast<unsigned char>(left[l])) && isdigit(static_cast<unsigned char>(right[r]))) {
+				while (l < left.size() && left[l] == '0') l++;
+				while (r < right.size() && right[r] == '0') r++;
+
+				size_t lEnd = l, rEnd = r;
+				while (lEnd < left.size() && isdigit(static_cast<unsigned char>(left[lEnd]))) lEnd++;
+				while (rEnd < right.size() && isdigit(static_cast<unsigned char>(right[rEnd]))) rEnd++;
+
+				// without leading zeros, the longer number is the larger one
+				if (lEnd - l != rEnd - r)
+					return lEnd - l < rEnd - r ? -1 : 1;
+				for (; l < lEnd; l++, r++)
+					if (left[l] != right[r])
+						return left[l] < right[r] ? -1 : 1;
+			} else {
+				if (left[l] != right[r])
+					return static_cast<unsigned char>(left[l]) < static_cast<unsigned char>(right[r]) ? -1 : 1;
+				l++;
+				r++;
+			}
+		}
+		if (l < left.size())
+			return 1;
+		if (r < right.size())
+			return -1;
+		return 0;
+	}
+
+	// order of the content table: directories first, then by the sort column (0 -> name, 1 -> date, 2 -> size), the name breaking ties
+	static bool ContentLess(const FileDialog::FileData& left, const FileDialog::FileData& right, unsigned int column, bool ascending)
+	{
+		if (left.IsDirectory != right.IsDirectory)
+			return left.IsDirectory;
+
+		int comp = 0;
+		if (column == 1) // date
+			comp = (left.DateModified > right.DateModified) - (left.DateModified < right.DateModified);
+		else if (column == 2) // size
+			comp = (left.Size > right.Size) - (left.Size < right.Size);
+		if (comp == 0) // name
+			comp = NaturalCompare(left.SearchName, right.SearchName);
+		return ascending ? comp < 0 : comp > 0;
+	}
+
+	/* ICON PREVIEWS */
+	static uint64_t HashPreviewKey(const std::string& path, time_t dateModified, size_t size)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&](const void* data, size_t length) {
+			for (size_t i = 0; i < length; i++) {
+				hash ^= static_cast<const uint8_t*>(data)[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		int64_t date = static_cast<int64_t>(dateModified);
+		uint64_t size64 = static_cast<uint64_t>(size);
+		int previewSize = PREVIEW_SIZE;
+		add(path.data(), path.size());
+		add(&date, sizeof(date));
+		add(&size64, sizeof(size64));
+		add(&previewSize, sizeof(previewSize));
+		return hash;
+	}
+	static bool ReadCachedPreview(const std::filesystem::path& file, std::vector<uint8_t>& pixels, int& width, int& height)
+	{
+		std::ifstream in(file, std::ios::binary);
+		if (!in.is_open())
+			return false;
+		std::vector<uint8_t> png((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+
+		int channels;
+		unsigned char* image = stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &width, &height, &channels, STBI_rgb_alpha);
+		if (image == nullptr)
+			return false;
+		if (width <= 0 || height <= 0 || width > PREVIEW_SIZE || height > PREVIEW_SIZE) {
+			stbi_image_free(image);
+			return false;
+		}
+		pixels.assign(image, image + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(image);
+
+		// the modification time tells PrunePreviewCache() when the preview was last used
+		std::error_code ec;
+		std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), ec);
+		return true;
+	}
+	static void WriteCachedPreview(const std::filesystem::path& file, const std::vector<uint8_t>& pixels, int width, int height)
+	{
+		std::vector<uint8_t> png;
+		auto append = [](void* context, void* data, int size) {
+			std::vector<uint8_t>& out = *static_cast<std::vector<uint8_t>*>(context);
+			out.insert(out.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+		};
+		if (!stbi_write_png_to_func(append, &png, width, height, 4, pixels.data(), width * 4))
+			return;
+
+		// write to a temporary file first, so that other threads and instances never read a partial preview. Its name is unique,
+		// as two workers can write the same preview when the directory is shown in two dialogs.
+		static std::atomic<unsigned int> tempCounter = 0;
+		char suffix[48];
+#ifdef _WIN32
+		snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", static_cast<unsigned long>(GetCurrentProcessId()), tempCounter.fetch_add(1));
+#else
+		snprintf(suffix, sizeof(suffix), ".%ld.%u.tmp", static_cast<long>(getpid()), tempCounter.fetch_add(1));
+#endif
+		std::filesystem::path tempFile = file;
+		tempFile += suffix;
+		{
+			std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+			if (!out.is_open())
+				return;
+
+			out.write(reinterpret_cast<const char*>(png.data()), png.size());
+			if (!out) {
+				out.close();
+				std::error_code ec;
+				std::filesystem::remove(tempFile, ec);
+				return;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempFile, file, ec);
+		if (ec)
+			std::filesystem::remove(tempFile, ec);
+	}
+	// the names written to the preview cache: "<key>.png" with the 16 hex digits of HashPreviewKey(), "<key>.png.<pid>.<n>.tmp" while it is
+	// written, and "<key>.thumb" or "<key>.thumb.tmp" of the raw previews stored by older versions
+	enum class PreviewCacheFile { Other, Preview, Temporary, Legacy };
+	static PreviewCacheFile GetPreviewCacheFileKind(const std::string& name)
+	{
+		const size_t keyLength = 16;
+		if (name.size() <= keyLength || !std::all_of(name.begin(), name.begin() + keyLength, [](char c) { return isxdigit(static_cast<unsigned char>(c)) != 0; }))
+			return PreviewCacheFile::Other;
+
+		std::string rest = name.substr(keyLength);
+		if (rest == ".png")
+			return PreviewCacheFile::Preview;
+		if (rest == ".thumb" || rest == ".thumb.tmp")
+			return PreviewCacheFile::Legacy;
+
+		const std::string prefix = ".png.", suffix = ".tmp";
+		if (rest.size() <= prefix.size() + suffix.size() || rest.compare(0, prefix.size(), prefix) != 0 || rest.compare(rest.size() - suffix.size(), suffix.size(), suffix) != 0)
+			return PreviewCacheFile::Other;
+		std::string counters = rest.substr(prefix.size(), rest.size() - prefix.size() - suffix.size());
+		size_t dot = counters.find('.');
+		bool digits = dot != std::string::npos && dot > 0 && dot + 1 < counters.size() &&
+			std::all_of(counters.begin(), counters.end(), [](char c) { return c == '.' || isdigit(static_cast<unsigned char>(c)); }) &&
+			counters.find('.', dot + 1) == std::string::npos;
+		return digits ? PreviewCacheFile::Temporary : PreviewCacheFile::Other;
+	}
+	// removes the previews which weren't used for the longest time until the cache fits in sizeLimit bytes, and those older than
+	// PREVIEW_CACHE_MAX_AGE days in any case. Also removes the raw previews of older versions and the temporary files of writers which
+	// didn't finish. Files with other names are left alone, the directory may be shared.
+	static void PrunePreviewCache(const std::filesystem::path& directory, uint64_t sizeLimit)
+	{
+		struct CachedFile {
+			std::filesystem::path Path;
+			std::filesystem::file_time_type LastUse;
+			uint64_t Size;
+		};
+		std::vector<CachedFile> files;
+		uint64_t totalSize = 0;
+		const auto now = std::filesystem::file_time_type::clock::now();
+		const auto maxAge = std::chrono::hours(24 * PREVIEW_CACHE_MAX_AGE);
+		const auto tempMaxAge = std::chrono::hours(1);
+
+		std::error_code ec;
+		for (auto it = std::filesystem::directory_iterator(directory, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+			std::error_code fileEc;
+			PreviewCacheFile kind = GetPreviewCacheFileKind(it->path().filename().string());
+			if (kind == PreviewCacheFile::Other || !it->is_regular_file(fileEc))
+				continue;
+			CachedFile file;
+			file.Path = it->path();
+			file.LastUse = it->last_write_time(fileEc);
+			file.Size = it->file_size(fileEc);
+			if (fileEc)
+				continue;
+
+			bool expired = kind == PreviewCacheFile::Legacy;
+			if (kind == PreviewCacheFile::Preview)
+				expired = now - file.LastUse > maxAge;
+			else if (kind == PreviewCacheFile::Temporary)
+				expired = now - file.LastUse > tempMaxAge;
+			if (expired) {
+				std::filesystem::remove(file.Path, fileEc);
+				continue;
+			}
+			if (kind == PreviewCacheFile::Preview) {
+				totalSize += file.Size;
+				files.push_back(std::move(file));
+			}
+		}
+		if (totalSize <= sizeLimit)
+			return;
+
+		std::sort(files.begin(), files.end(), [](const CachedFile& left, const CachedFile& right) { return left.LastUse < right.LastUse; });
+		for (const CachedFile& file : files) {
+			if (totalSize <= sizeLimit)
+				break;
+			std::error_code fileEc;
+			if (std::filesystem::remove(file.Path, fileEc))
+				totalSize -= file.Size;
+		}
+	}
+	// box filter down to fit maxSize x maxSize, smaller images are copied as they are
+	static void Downscale(const uint8_t* image, int width, int height, int maxSize, std::vector<uint8_t>& pixels, int& outWidth, int& outHeight)
+	{
+		float scale = std::min<float>(1.0f, std::min<float>(static_cast<float>(maxSize) / width, static_cast<float>(maxSize) / height));
+		outWidth = std::max(1, static_cast<int>(width * scale));
+		outHeight = std::max(1, static_cast<int>(height * scale));
+		pixels.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+
+		for (int y = 0; y < outHeight; y++) {
+			int y0 = static_cast<int>(static_cast<int64_t>(y) * height / outHeight);
+			int y1 = std::max(y0 + 1, static_cast<int>(static_cast<int64_t>(y + 1) * height / outHeight));
+			for (int x = 0; x < outWidth; x++) {
+				int x0 = static_cast<int>(static_cast<int64_t>(x) * width / outWidth);
+				int x1 = std::max(x0 + 1, static_cast<int>(static_cast<int64_t>(x + 1) * width / outWidth));
+
+				uint32_t sum[4] = { 0, 0, 0, 0 };
+				for (int sy = y0; sy < y1; sy++) {
+					const uint8_t* row = image + (static_cast<size_t>(sy) * width + x0) * 4;
+					for (int sx = x0; sx < x1; sx++, row += 4) {
+						sum[0] += row[0];
+						sum[1] += row[1];
+						sum[2] += row[2];
+						sum[3] += row[3];
+					}
+				}
+
+				uint32_t count = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+				uint8_t* out = &pixels[(static_cast<size_t>(y) * outWidth + x) * 4];
+				for (int c = 0; c < 4; c++)
+					out[c] = static_cast<uint8_t>(sum[c] / count);
+			}
+		}
+	}
+
+	// true if all characters of the query appear in the name, in the same order
+	static bool FuzzyMatch(const std::string& name, const std::string& query)
+	{
+		size_t q = 0;
+		for (size_t i = 0; i < name.size() && q < query.size(); i++)
+			if (name[i] == query[q])
+				q++;
+		return q == query.size();
+	}
+
 	/* UI CONTROLS */
-	bool FolderNode(const char* label, ImTextureID icon, bool& clicked)
+	// returns true if the folder was clicked, opened is toggled through the arrow or by double clicking
+	bool FolderNode(const char* label, ImTextureID icon, bool& opened, bool loading)
 	{
 		ImGuiContext& g = *GImGui;
 		ImGuiWindow* window = g.CurrentWindow;
 
-		clicked = false;
+		bool clicked = false;
 
-		ImU32 id = window->GetID(label);
-		int opened = window->StateStorage.GetInt(id, 0);
 		ImVec2 pos = window->DC.CursorPos;
 		const bool is_mouse_x_over_arrow = (g.IO.MousePos.x >= pos.x && g.IO.MousePos.x < pos.x + g.FontSize);
 		if (ImGui::InvisibleButton(label, ImVec2(-FLT_MIN, g.FontSize + g.Style.FramePadding.y * 2)))
 		{
-			if (is_mouse_x_over_arrow) {
-				int* p_opened = window->StateStorage.GetIntRef(id, 0);
-				opened = *p_opened = !*p_opened;
-			} else {
+			if (is_mouse_x_over_arrow)
+				opened = !opened;
+			else
 				clicked = true;
-			}
 		}
 		bool hovered = ImGui::IsItemHovered();
 		bool active = ImGui::IsItemActive();
 		bool doubleClick = ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left);
 		if (doubleClick && hovered) {
-			int* p_opened = window->StateStorage.GetIntRef(id, 0);
-			opened = *p_opened = !*p_opened;
+			opened = !opened;
 			clicked = false;
 		}
 		if (hovered || active)
@@ -69,12 +331,18 @@ namespace ifd {
 		// Icon, text
 		float icon_posX = pos.x + g.FontSize + g.Style.FramePadding.y;
 		float text_posX = icon_posX + g.Style.FramePadding.y + ICON_SIZE;
-		ImGui::RenderArrow(window->DrawList, ImVec2(pos.x, pos.y+g.Style.FramePadding.y), ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[((hovered && is_mouse_x_over_arrow) || opened) ? ImGuiCol_Text : ImGuiCol_TextDisabled]), opened ? ImGuiDir_Down : ImGuiDir_Right);
+		if (loading) {
+			// spinner in place of the arrow while the children are read
+			float radius = g.FontSize * 0.35f;
+			float start = static_cast<float>(g.Time) * 8.0f;
+			ImVec2 center(pos.x + g.FontSize * 0.5f, pos.y + g.Style.FramePadding.y + g.FontSize * 0.5f);
+			window->DrawList->PathArcTo(center, radius, start, start + PI * 1.5f, 12);
+			window->DrawList->PathStroke(ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[ImGuiCol_Text]), false, 2.0f);
+		} else
+			ImGui::RenderArrow(window->DrawList, ImVec2(pos.x, pos.y+g.Style.FramePadding.y), ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[((hovered && is_mouse_x_over_arrow) || opened) ? ImGuiCol_Text : ImGuiCol_TextDisabled]), opened ? ImGuiDir_Down : ImGuiDir_Right);
 		window->DrawList->AddImage(icon, ImVec2(icon_posX, pos.y), ImVec2(icon_posX + ICON_SIZE, pos.y + ICON_SIZE));
 		ImGui::RenderText(ImVec2(text_posX, pos.y + g.Style.FramePadding.y), label);
-		if (opened)
-			ImGui::TreePush(label);
-		return opened != 0;
+		return clicked;
 	}
 	bool FileNode(const char* label, ImTextureID icon) {
 		ImGuiContext& g = *GImGui;
@@ -281,11 +549,9 @@ namespace ifd {
 	}
 	bool FileIcon(const char* label, bool isSelected, ImTextureID icon, ImVec2 size, bool hasPreview, int previewWidth, int previewHeight)
 	{
-		ImGuiStyle& style = ImGui::GetStyle();
 		ImGuiContext& g = *GImGui;
 		ImGuiWindow* window = g.CurrentWindow;
 
-		float windowSpace = ImGui::GetWindowPos().x + ImGui::GetWindowContentRegionMax().x;
 		ImVec2 pos = window->DC.CursorPos;
 		bool ret = false;
 
@@ -323,30 +589,61 @@ namespace ifd {
 		
 		window->DrawList->AddText(g.Font, g.FontSize, ImVec2(pos.x + (size.x-textSize.x) / 2.0f, pos.y + iconSize), ImGui::ColorConvertFloat4ToU32(ImGui::GetStyle().Colors[ImGuiCol_Text]), label, 0, size.x);
 
-
-		float lastButtomPos = ImGui::GetItemRectMax().x;
-		float thisButtonPos = lastButtomPos + style.ItemSpacing.x + size.x; // Expected position if next button was on same line
-		if (thisButtonPos < windowSpace)
-			ImGui::SameLine();
-
 		return ret;
 	}
 
 	FileDialog::FileData::FileData(const std::filesystem::path& path) {
-		std::error_code ec;
 		Path = path;
-		IsDirectory = std::filesystem::is_directory(path, ec);
-		Size = std::filesystem::file_size(path, ec);
 
+		// a single stat per entry, it follows symlinks just like std::filesystem::is_directory
+		struct stat attr;
+		if (stat(path.string().c_str(), &attr) == 0) {
+			IsDirectory = (attr.st_mode & S_IFMT) == S_IFDIR;
+			Size = IsDirectory ? 0 : static_cast<size_t>(attr.st_size);
+			DateModified = attr.st_ctime;
+		} else {
+			IsDirectory = !path.has_filename(); // drive
+			Size = 0;
+			DateModified = 0;
+		}
+
+		DisplayName = path.filename().string();
+		if (DisplayName.size() == 0)
+			DisplayName = path.string(); // drive
+
+		// Also constructed on the directory worker, std::localtime() would share its result with the main thread.
+		char buffer[64];
+		std::tm time = {};
+#ifdef _WIN32
+		const bool converted = localtime_s(&time, &DateModified) == 0;
+#else
+		const bool converted = localtime_r(&DateModified, &time) != nullptr;
+#endif
+		if (converted) {
+			snprintf(buffer, sizeof(buffer), "%d/%d/%d %02d:%02d", time.tm_mon + 1, time.tm_mday, 1900 + time.tm_year, time.tm_hour, time.tm_min);
+			DateString = buffer;
+		} else
+			DateString = "---";
+
+		snprintf(buffer, sizeof(buffer), "%.3f KiB", Size / 1024.0f);
+		SizeString = buffer;
+
+		SearchName = DisplayName;
+		std::transform(SearchName.begin(), SearchName.end(), SearchName.begin(), ::tolower);
+		IsSelected = false;
+
+		std::string ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		IsImage = !IsDirectory && (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga");
+	}
+	bool FileDialog::FileData::IsOutdated() const {
 		struct stat attr;
-		stat(path.string().c_str(), &attr);
-		DateModified = attr.st_ctime;
-
-		HasIconPreview = false;
-		IconPreview = nullptr;
-		IconPreviewData = nullptr;
-		IconPreviewHeight = 0;
-		IconPreviewWidth = 0;
+		if (stat(Path.string().c_str(), &attr) != 0)
+			return Size != 0 || DateModified != 0;
+
+		bool isDirectory = (attr.st_mode & S_IFMT) == S_IFDIR;
+		size_t size = isDirectory ? 0 : static_cast<size_t>(attr.st_size);
+		return isDirectory != IsDirectory || size != Size || attr.st_ctime != DateModified;
 	}
 
 	FileDialog::FileDialog() {
@@ -363,89 +660,36 @@ namespace ifd {
 		m_selectedFileItem = -1;
 		m_zoom = 1.0f;
 
-		m_previewLoader = nullptr;
-		m_previewLoaderRunning = false;
-
-		m_setDirectory(std::filesystem::current_path(), false);
-
-		// favorites are available on every OS
-		FileTreeNode* quickAccess = new FileTreeNode("Quick Access");
-		quickAccess->Read = true;
-		m_treeCache.push_back(quickAccess);
+		m_previewWorkersRunning = false;
+		m_previewGeneration = 0;
+		PreviewCacheSizeLimit = 64 * 1024 * 1024;
 
 #ifdef _WIN32
-		wchar_t username[UNLEN + 1] = { 0 };
-		DWORD username_len = UNLEN + 1;
-		GetUserNameW(username, &username_len);
-
-		std::wstring userPath = L"C:\\Users\\" + std::wstring(username) + L"\\";
-
-		// Quick Access / Bookmarks
-		quickAccess->Children.push_back(new FileTreeNode(userPath + L"Desktop"));
-		quickAccess->Children.push_back(new FileTreeNode(userPath + L"Documents"));
-		quickAccess->Children.push_back(new FileTreeNode(userPath + L"Downloads"));
-		quickAccess->Children.push_back(new FileTreeNode(userPath + L"Pictures"));
-
-		// OneDrive
-		FileTreeNode* oneDrive = new FileTreeNode(userPath + L"OneDrive");
-		m_treeCache.push_back(oneDrive);
-
-		// This PC
-		FileTreeNode* thisPC = new FileTreeNode("This PC");
-		thisPC->Read = true;
-		if (std::filesystem::exists(userPath + L"3D Objects"))
-			thisPC->Children.push_back(new FileTreeNode(userPath + L"3D Objects"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Desktop"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Documents"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Downloads"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Music"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Pictures"));
-		thisPC->Children.push_back(new FileTreeNode(userPath + L"Videos"));
-		DWORD d = GetLogicalDrives();
-		for (int i = 0; i < 26; i++)
-			if (d & (1 << i))
-				thisPC->Children.push_back(new FileTreeNode(std::string(1, 'A' + i) + ":"));
-		m_treeCache.push_back(thisPC);
+		std::error_code tempEc;
+		std::filesystem::path tempPath = std::filesystem::temp_directory_path(tempEc);
+		if (!tempEc)
+			PreviewCacheDirectory = tempPath / "ImFileDialog";
 #else
-		std::error_code ec;
+		if (const char* cacheHome = getenv("XDG_CACHE_HOME"))
+			PreviewCacheDirectory = std::filesystem::path(cacheHome) / "ImFileDialog";
+		else if (const char* home = getenv("HOME"))
+			PreviewCacheDirectory = std::filesystem::path(home) / ".cache" / "ImFileDialog";
+#endif
 
-		// Quick Access
-		struct passwd *pw;
-		uid_t uid;
-		uid = geteuid();
-		pw = getpwuid(uid);
-		if (pw) {
-			std::string homePath = "/home/" + std::string(pw->pw_name);
-			
-			if (std::filesystem::exists(homePath, ec))
-				quickAccess->Children.push_back(new FileTreeNode(homePath));
-			if (std::filesystem::exists(homePath + "/Desktop", ec))
-				quickAccess->Children.push_back(new FileTreeNode(homePath + "/Desktop"));
-			if (std::filesystem::exists(homePath + "/Documents", ec))
-				quickAccess->Children.push_back(new FileTreeNode(homePath + "/Documents"));
-			if (std::filesystem::exists(homePath + "/Downloads", ec))
-				quickAccess->Children.push_back(new FileTreeNode(homePath + "/Downloads"));
-			if (std::filesystem::exists(homePath + "/Pictures", ec))
-				quickAccess->Children.push_back(new FileTreeNode(homePath + "/Pictures"));
-		}
+		m_listingUseCount = 0;
 
-		// This PC
-		FileTreeNode* thisPC = new FileTreeNode("This PC");
-		thisPC->Read = true;
-		for (const auto& entry : std::filesystem::directory_iterator("/", ec)) {
-			if (std::filesystem::is_directory(entry, ec))
-				thisPC->Children.push_back(new FileTreeNode(entry.path().string()));
-		}
-		m_treeCache.push_back(thisPC);
-#endif
+		m_setDirectory(std::filesystem::current_path(), false);
+		m_buildTree();
 	}
 	FileDialog::~FileDialog() {
+		m_stopContentLoader();
+		m_stopPreviewWorkers();
 		m_clearIconPreview();
 		m_clearIcons();
 
-		for (auto fn : m_treeCache)
-			m_clearTree(fn);
+		m_cancelTreeListings();
 		m_treeCache.clear();
+		m_treeNodes.clear();
 	}
 	bool FileDialog::Save(const std::string& key, const std::string& title, const std::string& filter, const std::string& startingDir)
 	{
@@ -517,21 +761,19 @@ namespace ifd {
 	}
 	void FileDialog::Close()
 	{
+		m_stopContentLoader();
 		m_currentKey.clear();
 		m_backHistory = std::stack<std::filesystem::path>();
 		m_forwardHistory = std::stack<std::filesystem::path>();
 
-		// clear the tree
-		for (auto fn : m_treeCache) {
-			for (auto item : fn->Children) {
-				for (auto ch : item->Children)
-					m_clearTree(ch);
-				item->Children.clear();
-				item->Read = false;
-			}
-		}
+		// clear the tree, the nodes are freed all at once. The enumerations which are still running finish on their own.
+		m_cancelTreeListings();
+		m_treeCache.clear();
+		m_treeNodes.clear();
+		m_buildTree();
 
 		// free icon textures
+		m_stopPreviewWorkers();
 		m_clearIconPreview();
 		m_clearIcons();
 	}
@@ -567,7 +809,7 @@ namespace ifd {
 		// add to sidebar
 		for (auto& p : m_treeCache)
 			if (p->Path == "Quick Access") {
-				p->Children.push_back(new FileTreeNode(path));
+				p->Children.push_back(m_newTreeNode(std::filesystem::u8path(path)));
 				break;
 			}
 	}
@@ -587,6 +829,13 @@ namespace ifd {
 				m_selections.push_back(path);
 		}
 
+		for (auto& data : m_content) {
+			if (data.Path == path)
+				data.IsSelected = multiselect ? !data.IsSelected : true;
+			else if (!multiselect)
+				data.IsSelected = false;
+		}
+
 		if (m_selections.size() == 1) {
 			std::string filename = m_selections[0].filename().string();
 			if (filename.size() == 0)
@@ -839,80 +1088,309 @@ namespace ifd {
 	}
 	void FileDialog::m_refreshIconPreview()
 	{
-		if (m_zoom >= 5.0f) {
-			if (m_previewLoader == nullptr) {
-				m_previewLoaderRunning = true;
-				m_previewLoader = new std::thread(&FileDialog::m_loadPreview, this);
-			}
-		} else
+		// previews are requested by m_renderContent for the visible entries
+		if (m_zoom < 5.0f)
 			m_clearIconPreview();
 	}
 	void FileDialog::m_clearIconPreview()
 	{
-		m_stopPreviewLoader();
+		for (auto& preview : m_iconPreviews)
+			if (preview.second.Texture != nullptr)
+				DeleteTexture(preview.second.Texture);
+		m_iconPreviews.clear();
+
+		std::lock_guard<std::mutex> lock(m_previewMutex);
+		m_previewJobs.clear();
+		m_previewResults.clear();
+		m_previewGeneration++;
+	}
+	void FileDialog::m_requestPreviews(std::vector<PreviewJob>& jobs)
+	{
+		if (!m_previewWorkersRunning) {
+			if (jobs.empty())
+				return;
 
-		for (auto& data : m_content) {
-			if (!data.HasIconPreview)
+			std::error_code ec;
+			if (!PreviewCacheDirectory.empty())
+				std::filesystem::create_directories(PreviewCacheDirectory, ec);
+
+			m_previewWorkersRunning = true;
+			unsigned int workerCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+			for (unsigned int i = 0; i < workerCount; i++)
+				m_previewWorkers.emplace_back(&FileDialog::m_previewWorker, this, i == 0 && !PreviewCacheDirectory.empty());
+		}
+
+		// only the entries visible right now are worth decoding, drop the requests of previous frames
+		std::lock_guard<std::mutex> lock(m_previewMutex);
+		m_previewJobs.clear();
+		for (auto& job : jobs) {
+			if (std::count(m_previewsInProgress.begin(), m_previewsInProgress.end(), job.Name))
 				continue;
+			job.Generation = m_previewGeneration;
+			m_previewJobs.push_back(std::move(job));
+		}
+		m_previewCondition.notify_all();
+	}
+	void FileDialog::m_uploadPreviews()
+	{
+		std::vector<PreviewResult> results;
+		unsigned int generation;
+		{
+			std::lock_guard<std::mutex> lock(m_previewMutex);
+			results.swap(m_previewResults);
+			generation = m_previewGeneration;
+		}
 
-			data.HasIconPreview = false;
-			this->DeleteTexture(data.IconPreview);
+		for (auto& result : results) {
+			if (result.Generation != generation)
+				continue;
 
-			if (data.IconPreviewData != nullptr) {
-				stbi_image_free(data.IconPreviewData);
-				data.IconPreviewData = nullptr;
-			}
+			IconPreview& preview = m_iconPreviews[result.Name];
+			preview.Texture = result.Pixels.empty() ? nullptr : this->CreateTexture(result.Pixels.data(), result.Width, result.Height, 1);
+			preview.Width = result.Width;
+			preview.Height = result.Height;
 		}
 	}
-	void FileDialog::m_stopPreviewLoader()
+	void FileDialog::m_stopPreviewWorkers()
 	{
-		if (m_previewLoader != nullptr) {
-			m_previewLoaderRunning = false;
+		{
+			std::lock_guard<std::mutex> lock(m_previewMutex);
+			m_previewWorkersRunning = false;
+			m_previewJobs.clear();
+		}
+		m_previewCondition.notify_all();
+
+		for (auto& worker : m_previewWorkers)
+			if (worker.joinable())
+				worker.join();
+		m_previewWorkers.clear();
+		m_previewsInProgress.clear();
+		m_previewResults.clear();
+	}
+	void FileDialog::m_previewWorker(bool pruneCache)
+	{
+		if (pruneCache)
+			PrunePreviewCache(PreviewCacheDirectory, PreviewCacheSizeLimit);
+
+		while (true) {
+			PreviewJob job;
+			{
+				std::unique_lock<std::mutex> lock(m_previewMutex);
+				m_previewCondition.wait(lock, [this]() { return !m_previewWorkersRunning || !m_previewJobs.empty(); });
+				if (!m_previewWorkersRunning)
+					return;
+
+				job = std::move(m_previewJobs.front());
+				m_previewJobs.pop_front();
+				m_previewsInProgress.push_back(job.Name);
+			}
 
-			if (m_previewLoader && m_previewLoader->joinable())
-				m_previewLoader->join();
+			PreviewResult result;
+			result.Name = job.Name;
+			result.Generation = job.Generation;
+			result.Width = result.Height = 0;
+			m_loadPreview(job, result);
+
+			{
+				std::lock_guard<std::mutex> lock(m_previewMutex);
+				auto it = std::find(m_previewsInProgress.begin(), m_previewsInProgress.end(), job.Name);
+				if (it != m_previewsInProgress.end())
+					m_previewsInProgress.erase(it);
+				m_previewResults.push_back(std::move(result));
+			}
 
-			delete m_previewLoader;
-			m_previewLoader = nullptr;
+			if (RequestRedraw)
+				RequestRedraw();
 		}
 	}
-	void FileDialog::m_loadPreview()
+	void FileDialog::m_loadPreview(const PreviewJob& job, PreviewResult& result)
 	{
-		for (size_t i = 0; m_previewLoaderRunning && i < m_content.size(); i++) {
-			auto& data = m_content[i];
+		std::filesystem::path cachePath;
+		if (!PreviewCacheDirectory.empty()) {
+			char name[32];
+			snprintf(name, sizeof(name), "%016llx.png", static_cast<unsigned long long>(HashPreviewKey(job.Path.string(), job.DateModified, job.Size)));
+			cachePath = PreviewCacheDirectory / name;
+
+			if (ReadCachedPreview(cachePath, result.Pixels, result.Width, result.Height))
+				return;
+		}
 
-			if (data.HasIconPreview)
-				continue;
+		int width, height, nrChannels;
+		unsigned char* image = stbi_load(job.Path.string().c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+		if (image == nullptr || width <= 0 || height <= 0) {
+			if (image != nullptr)
+				stbi_image_free(image);
+			return;
+		}
 
-			if (data.Path.has_extension()) {
-				std::string ext = data.Path.extension().string();
-				if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga") {
-					int width, height, nrChannels;
-					unsigned char* image = stbi_load(data.Path.string().c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+		// only keep the downscaled image around, the full one can take up hundreds of megabytes
+		Downscale(image, width, height, PREVIEW_SIZE, result.Pixels, result.Width, result.Height);
+		stbi_image_free(image);
 
-					if (image == nullptr || width == 0 || height == 0)
-						continue;
+		if (!cachePath.empty())
+			WriteCachedPreview(cachePath, result.Pixels, result.Width, result.Height);
+	}
+	FileDialog::FileTreeNode* FileDialog::m_newTreeNode(const std::filesystem::path& path)
+	{
+		// native() picks the std::string or std::wstring constructor
+		FileTreeNode& node = m_treeNodes.emplace_back(path.native());
+		node.Path = path;
+		node.DisplayName = path.stem().string();
+		if (node.DisplayName.size() == 0)
+			node.DisplayName = path.string();
+		return &node;
+	}
+	void FileDialog::m_buildTree()
+	{
+		// favorites are available on every OS
+		FileTreeNode* quickAccess = m_newTreeNode("Quick Access");
+		quickAccess->Read = true;
+		m_treeCache.push_back(quickAccess);
 
-					data.HasIconPreview = true;
-					data.IconPreviewData = image;
-					data.IconPreviewWidth = width;
-					data.IconPreviewHeight = height;
-				}
-			}
+#ifdef _WIN32
+		wchar_t username[UNLEN + 1] = { 0 };
+		DWORD username_len = UNLEN + 1;
+		GetUserNameW(username, &username_len);
+
+		std::wstring userPath = L"C:\\Users\\" + std::wstring(username) + L"\\";
+
+		// Quick Access / Bookmarks
+		quickAccess->Children.push_back(m_newTreeNode(userPath + L"Desktop"));
+		quickAccess->Children.push_back(m_newTreeNode(userPath + L"Documents"));
+		quickAccess->Children.push_back(m_newTreeNode(userPath + L"Downloads"));
+		quickAccess->Children.push_back(m_newTreeNode(userPath + L"Pictures"));
+
+		// OneDrive
+		FileTreeNode* oneDrive = m_newTreeNode(userPath + L"OneDrive");
+		m_treeCache.push_back(oneDrive);
+
+		// This PC
+		FileTreeNode* thisPC = m_newTreeNode("This PC");
+		thisPC->Read = true;
+		if (std::filesystem::exists(userPath + L"3D Objects"))
+			thisPC->Children.push_back(m_newTreeNode(userPath + L"3D Objects"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Desktop"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Documents"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Downloads"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Music"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Pictures"));
+		thisPC->Children.push_back(m_newTreeNode(userPath + L"Videos"));
+		DWORD d = GetLogicalDrives();
+		for (int i = 0; i < 26; i++)
+			if (d & (1 << i))
+				thisPC->Children.push_back(m_newTreeNode(std::string(1, 'A' + i) + ":"));
+		m_treeCache.push_back(thisPC);
+#else
+		std::error_code ec;
+
+		// Quick Access
+		struct passwd *pw;
+		uid_t uid;
+		uid = geteuid();
+		pw = getpwuid(uid);
+		if (pw) {
+			std::string homePath = "/home/" + std::string(pw->pw_name);
+			
+			if (std::filesystem::exists(homePath, ec))
+				quickAccess->Children.push_back(m_newTreeNode(homePath));
+			if (std::filesystem::exists(homePath + "/Desktop", ec))
+				quickAccess->Children.push_back(m_newTreeNode(homePath + "/Desktop"));
+			if (std::filesystem::exists(homePath + "/Documents", ec))
+				quickAccess->Children.push_back(m_newTreeNode(homePath + "/Documents"));
+			if (std::filesystem::exists(homePath + "/Downloads", ec))
+				quickAccess->Children.push_back(m_newTreeNode(homePath + "/Downloads"));
+			if (std::filesystem::exists(homePath + "/Pictures", ec))
+				quickAccess->Children.push_back(m_newTreeNode(homePath + "/Pictures"));
+		}
+
+		// This PC
+		FileTreeNode* thisPC = m_newTreeNode("This PC");
+		thisPC->Read = true;
+		for (const auto& entry : std::filesystem::directory_iterator("/", ec)) {
+			if (std::filesystem::is_directory(entry, ec))
+				thisPC->Children.push_back(m_newTreeNode(entry.path()));
 		}
+		m_treeCache.push_back(thisPC);
+#endif
 
-		m_previewLoaderRunning = false;
+		for (const auto& favorite : m_favorites)
+			quickAccess->Children.push_back(m_newTreeNode(std::filesystem::u8path(favorite)));
 	}
-	void FileDialog::m_clearTree(FileTreeNode* node)
+	void FileDialog::m_expandTreeNode(FileTreeNode* node)
 	{
-		if (node == nullptr)
+		// already in progress, or not a directory and the children never change
+		if (node->PendingListing || node->Path == "Quick Access" || node->Path == "This PC")
 			return;
 
-		for (auto n : node->Children)
-			m_clearTree(n);
+		std::filesystem::path path = node->Path;
+		bool read = node->Read;
+		std::filesystem::file_time_type dateModified = node->DateModified;
+		// the thread may outlive the dialog, so it doesn't touch it
+		std::shared_ptr<FileTreeNode::Listing> listing = std::make_shared<FileTreeNode::Listing>();
+		std::function<void()> requestRedraw = RequestRedraw;
+		node->PendingListing = listing;
+		std::thread([listing, path, read, dateModified, requestRedraw]() {
+			std::error_code ec;
+			listing->DateModified = std::filesystem::last_write_time(path, ec);
+			listing->Changed = !read || ec || listing->DateModified != dateModified;
+			if (listing->Changed && !ec) {
+				// the type is usually known from reading the directory already, unlike std::filesystem::is_directory(path) it doesn't need a stat() per entry
+				for (auto it = std::filesystem::directory_iterator(path, ec); !ec && it != std::filesystem::directory_iterator() && !listing->Cancelled.load(std::memory_order_relaxed); it.increment(ec)) {
+					std::error_code typeEc;
+					if (it->is_directory(typeEc))
+						listing->Children.push_back(it->path());
+				}
+			}
+
+			listing->Done.store(true, std::memory_order_release);
+			if (requestRedraw && !listing->Cancelled.load(std::memory_order_relaxed))
+				requestRedraw();
+		}).detach();
+		m_loadingTreeNodes.push_back(node);
+	}
+	void FileDialog::m_pollTree()
+	{
+		for (size_t i = 0; i < m_loadingTreeNodes.size();) {
+			FileTreeNode* node = m_loadingTreeNodes[i];
+			if (!node->PendingListing->Done.load(std::memory_order_acquire)) {
+				i++;
+				continue;
+			}
+			m_loadingTreeNodes.erase(m_loadingTreeNodes.begin() + i);
 
-		delete node;
-		node = nullptr;
+			std::shared_ptr<FileTreeNode::Listing> pending = std::move(node->PendingListing);
+			FileTreeNode::Listing& listing = *pending;
+			node->Read = true;
+			if (!listing.Changed)
+				continue;
+			node->DateModified = listing.DateModified;
+
+			// keep the nodes of the folders which are still there, together with their expanded subtrees
+			std::unordered_map<std::string, FileTreeNode*> previous;
+			for (FileTreeNode* child : node->Children)
+				previous[child->Path.string()] = child;
+
+			std::vector<FileTreeNode*> children;
+			children.reserve(listing.Children.size());
+			for (const auto& path : listing.Children) {
+				auto it = previous.find(path.string());
+				children.push_back(it != previous.end() ? it->second : m_newTreeNode(path));
+			}
+			node->Children = std::move(children);
+		}
+	}
+	void FileDialog::m_cancelTreeListings()
+	{
+		for (FileTreeNode* node : m_loadingTreeNodes)
+			node->PendingListing->Cancelled.store(true, std::memory_order_relaxed);
+		m_loadingTreeNodes.clear();
+	}
+	void FileDialog::m_flattenTree(FileTreeNode* node, int depth)
+	{
+		m_treeRows.push_back(std::make_pair(node, depth));
+		if (node->Open)
+			for (FileTreeNode* child : node->Children)
+				m_flattenTree(child, depth + 1);
 	}
 	void FileDialog::m_setDirectory(const std::filesystem::path& p, bool addHistory)
 	{
@@ -928,6 +1406,7 @@ namespace ifd {
 			m_currentDirectory = std::filesystem::u8path(p.string() + "\\");
 #endif
 
+		m_stopContentLoader();
 		m_clearIconPreview();
 		m_content.clear(); // p == "" after this line, due to reference
 		m_selectedFileItem = -1;
@@ -938,6 +1417,7 @@ namespace ifd {
 
 		if (!isSameDir) {
 			m_searchBuffer[0] = 0;
+			m_searchQuery.clear();
 			m_clearIcons();
 		}
 
@@ -957,143 +1437,358 @@ namespace ifd {
 		}
 		else {
 			std::error_code ec;
-			if (std::filesystem::exists(m_currentDirectory, ec))
-				for (const auto& entry : std::filesystem::directory_iterator(m_currentDirectory, ec)) {
-					FileData info(entry.path());
+			auto dateModified = std::filesystem::last_write_time(m_currentDirectory, ec);
 
-					// skip files when IFD_DIALOG_DIRECTORY
-					if (!info.IsDirectory && m_type == IFD_DIALOG_DIRECTORY)
-						continue;
+			DirectoryListing& listing = m_listings[m_currentDirectory.string()];
+			listing.LastUsed = ++m_listingUseCount;
+			if (!listing.Watched && WatchDirectory) {
+				WatchDirectory(m_currentDirectory);
+				listing.Watched = true;
+			}
+			if (!ec && listing.Complete && listing.DateModified == dateModified) {
+				for (auto& info : listing.Entries) {
+					if (info.IsOutdated())
+						info = FileData(info.Path);
+					if (m_matchesFilter(info))
+						m_content.push_back(info);
+				}
+			} else {
+				listing.DateModified = dateModified;
+				listing.Complete = false;
+				listing.Entries.clear();
 
-					// check if filename matches search query
-					if (m_searchBuffer[0]) {
-						std::string filename = info.Path.string();
+				m_contentLoader = std::make_shared<ContentLoader>();
+				std::thread(&FileDialog::m_loadContent, m_contentLoader, m_currentDirectory, RequestRedraw).detach();
+			}
+			m_trimListings();
+		}
 
-						std::string filenameSearch = filename;
-						std::string query(m_searchBuffer);
-						std::transform(filenameSearch.begin(), filenameSearch.end(), filenameSearch.begin(), ::tolower);
-						std::transform(query.begin(), query.end(), query.begin(), ::tolower);
+		m_sortContent(m_sortColumn, m_sortDirection);
+	}
+	bool FileDialog::m_matchesFilter(const FileData& info)
+	{
+		// skip files when IFD_DIALOG_DIRECTORY
+		if (!info.IsDirectory && m_type == IFD_DIALOG_DIRECTORY)
+			return false;
 
-						if (filenameSearch.find(query, 0) == std::string::npos)
-							continue;
-					}
+		// check if filename matches search query
+		if (!m_searchQuery.empty() && !FuzzyMatch(info.SearchName, m_searchQuery))
+			return false;
 
-					// check if extension matches
-					if (!info.IsDirectory && m_type != IFD_DIALOG_DIRECTORY) {
-						if (m_filterSelection < m_filterExtensions.size()) {
-							const auto& exts = m_filterExtensions[m_filterSelection];
-							if (exts.size() > 0) {
-								std::string extension = info.Path.extension().string();
-
-								// extension not found? skip
-								if (std::count(exts.begin(), exts.end(), extension) == 0)
-									continue;
-							}
-						}
-					}
+		// check if extension matches
+		if (!info.IsDirectory && m_type != IFD_DIALOG_DIRECTORY) {
+			if (m_filterSelection < m_filterExtensions.size()) {
+				const auto& exts = m_filterExtensions[m_filterSelection];
+				if (exts.size() > 0) {
+					std::string extension = info.Path.extension().string();
 
-					m_content.push_back(info);
+					// extension not found? skip
+					if (std::count(exts.begin(), exts.end(), extension) == 0)
+						return false;
 				}
+			}
 		}
 
-		m_sortContent(m_sortColumn, m_sortDirection);
-		m_refreshIconPreview();
+		return true;
 	}
-	void FileDialog::m_sortContent(unsigned int column, unsigned int sortDirection)
+	void FileDialog::m_trimListings()
 	{
-		// 0 -> name, 1 -> date, 2 -> size
-		m_sortColumn = column;
-		m_sortDirection = sortDirection;
+		const size_t maxListings = 8;
+		while (m_listings.size() > maxListings) {
+			auto oldest = m_listings.end();
+			for (auto it = m_listings.begin(); it != m_listings.end(); ++it)
+				if (it->first != m_currentDirectory.string() && (oldest == m_listings.end() || it->second.LastUsed < oldest->second.LastUsed))
+					oldest = it;
+			if (oldest == m_listings.end())
+				break;
+			m_eraseListing(oldest->first);
+		}
+	}
+	void FileDialog::m_eraseListing(const std::string& directory)
+	{
+		auto listing = m_listings.find(directory);
+		if (listing == m_listings.end())
+			return;
 
-		// split into directories and files
-		std::partition(m_content.begin(), m_content.end(), [](const FileData& data) {
-			return data.IsDirectory;
-		});
+		if (listing->second.Watched && UnwatchDirectory)
+			UnwatchDirectory(std::filesystem::u8path(directory));
+		m_listings.erase(listing);
+	}
+	void FileDialog::OnFilesChanged(const std::filesystem::path& directory, const std::vector<std::string>& names)
+	{
+		std::string key = directory.string();
+		auto listing = m_listings.find(key);
+		if (listing == m_listings.end())
+			return;
 
-		if (m_content.size() > 0) {
-			// find where the file list starts
-			size_t fileIndex = 0;
-			for (; fileIndex < m_content.size(); fileIndex++)
-				if (!m_content[fileIndex].IsDirectory)
-					break;
+		bool isCurrent = key == m_currentDirectory.string();
 
-			// compare function
-			auto compareFn = [column, sortDirection](const FileData& left, const FileData& right) -> bool {
-				// name
-				if (column == 0) {
-					std::string lName = left.Path.string();
-					std::string rName = right.Path.string();
+		// the listing is still being read or anything could have changed, read it again
+		if (!listing->second.Complete || names.empty()) {
+			listing->second.Complete = false;
+			if (isCurrent && m_contentLoader == nullptr)
+				m_setDirectory(m_currentDirectory, false);
+			return;
+		}
 
-					std::transform(lName.begin(), lName.end(), lName.begin(), ::tolower);
-					std::transform(rName.begin(), rName.end(), rName.begin(), ::tolower);
+		std::filesystem::path selectedItem;
+		if (isCurrent && m_selectedFileItem >= 0 && m_selectedFileItem < static_cast<int>(m_content.size()))
+			selectedItem = m_content[m_selectedFileItem].Path;
 
-					int comp = lName.compare(rName);
+		auto& entries = listing->second.Entries;
+		for (const auto& name : names) {
+			auto byName = [&](const FileData& data) { return data.DisplayName == name; };
 
-					if (sortDirection == ImGuiSortDirection_Ascending)
-						return comp < 0;
-					return comp > 0;
-				}
-				// date
-				else if (column == 1) {
-					if (sortDirection == ImGuiSortDirection_Ascending)
-						return left.DateModified < right.DateModified;
-					else
-						return left.DateModified > right.DateModified;
-				}
-				// size
-				else if (column == 2) {
-					if (sortDirection == ImGuiSortDirection_Ascending)
-						return left.Size < right.Size;
-					else
-						return left.Size > right.Size;
+			std::error_code ec;
+			std::filesystem::path path = directory / std::filesystem::u8path(name);
+			bool exists = std::filesystem::exists(std::filesystem::symlink_status(path, ec)) && !ec;
+
+			entries.erase(std::remove_if(entries.begin(), entries.end(), byName), entries.end());
+			if (exists)
+				entries.push_back(FileData(path));
+
+			if (!isCurrent)
+				continue;
+
+			bool wasSelected = false;
+			for (auto it = m_content.begin(); it != m_content.end(); ++it)
+				if (it->DisplayName == name) {
+					wasSelected = it->IsSelected;
+					m_content.erase(it);
+					break;
 				}
+			if (exists && m_matchesFilter(entries.back())) {
+				m_content.push_back(entries.back());
+				m_content.back().IsSelected = wasSelected;
+			}
 
-				return false;
-			};
+			// the file might have a new image
+			auto preview = m_iconPreviews.find(name);
+			if (preview != m_iconPreviews.end()) {
+				if (preview->second.Texture != nullptr)
+					DeleteTexture(preview->second.Texture);
+				m_iconPreviews.erase(preview);
+			}
+		}
+
+		// the listing matches the directory again
+		std::error_code ec;
+		listing->second.DateModified = std::filesystem::last_write_time(directory, ec);
 
-			// sort the directories
-			std::sort(m_content.begin(), m_content.begin() + fileIndex, compareFn);
+		if (isCurrent) {
+			m_sortContent(m_sortColumn, m_sortDirection);
 
-			// sort the files
-			std::sort(m_content.begin() + fileIndex, m_content.end(), compareFn);
+			m_selectedFileItem = -1;
+			for (size_t i = 0; !selectedItem.empty() && i < m_content.size(); i++)
+				if (m_content[i].Path == selectedItem) {
+					m_selectedFileItem = static_cast<int>(i);
+					break;
+				}
 		}
 	}
+	void FileDialog::m_applySearch()
+	{
+		std::string query(m_searchBuffer);
+		std::transform(query.begin(), query.end(), query.begin(), ::tolower);
+		bool isNarrowing = query.compare(0, m_searchQuery.size(), m_searchQuery) == 0;
+		m_searchQuery = query;
+
+		// "Quick Access" and "This PC" aren't cached
+		auto listing = m_listings.find(m_currentDirectory.string());
+		if (listing == m_listings.end()) {
+			m_setDirectory(m_currentDirectory, false);
+			return;
+		}
+
+		m_selectedFileItem = -1;
 
-	void FileDialog::m_renderTree(FileTreeNode* node)
+		// a longer query only matches a subset of the current entries
+		if (isNarrowing) {
+			auto removed = std::stable_partition(m_content.begin(), m_content.end(), [&](const FileData& info) {
+				return FuzzyMatch(info.SearchName, m_searchQuery);
+			});
+			m_content.erase(removed, m_content.end());
+		} else {
+			m_content.clear();
+			for (const auto& info : listing->second.Entries) {
+				if (!m_matchesFilter(info))
+					continue;
+
+				m_content.push_back(info);
+				if (!m_selections.empty())
+					m_content.back().IsSelected = std::count(m_selections.begin(), m_selections.end(), info.Path) > 0;
+			}
+			m_sortContent(m_sortColumn, m_sortDirection);
+		}
+	}
+	void FileDialog::m_stopContentLoader()
+	{
+		// the thread finishes on its own, a directory on a slow drive must not block the UI
+		if (m_contentLoader != nullptr) {
+			m_contentLoader->Cancelled = true;
+			m_contentLoader = nullptr;
+		}
+	}
+	void FileDialog::m_loadContent(std::shared_ptr<ContentLoader> loader, std::filesystem::path directory, std::function<void()> requestRedraw)
 	{
-		// directory
+		std::vector<FileData> batch;
+		auto lastHandOver = std::chrono::steady_clock::now();
+		auto handOver = [&](bool done) {
+			{
+				std::lock_guard<std::mutex> lock(loader->Mutex);
+				loader->Batch.insert(loader->Batch.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+				loader->Done = done;
+			}
+			batch.clear();
+			lastHandOver = std::chrono::steady_clock::now();
+
+			if (requestRedraw && !loader->Cancelled)
+				requestRedraw();
+		};
+
 		std::error_code ec;
-		ImGui::PushID(node);
-		bool isClicked = false;
-		std::string displayName = node->Path.stem().string();
-		if (displayName.size() == 0)
-			displayName = node->Path.string();
-		if (FolderNode(displayName.c_str(), (ImTextureID)m_getIcon(node->Path), isClicked)) {
-			if (!node->Read) {
-				// cache children if it's not already cached
-				if (std::filesystem::exists(node->Path, ec))
-					for (const auto& entry : std::filesystem::directory_iterator(node->Path, ec)) {
-						if (std::filesystem::is_directory(entry, ec))
-							node->Children.push_back(new FileTreeNode(entry.path().string()));
+		for (auto it = std::filesystem::directory_iterator(directory, ec); !loader->Cancelled && !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+			batch.push_back(FileData(it->path()));
+
+			// hand over the entries regularly, so that slow (network) drives show something early
+			if (batch.size() >= 256 || std::chrono::steady_clock::now() - lastHandOver > std::chrono::milliseconds(50))
+				handOver(false);
+		}
+
+		if (!loader->Cancelled)
+			handOver(true);
+	}
+	void FileDialog::m_pollContentLoader()
+	{
+		if (m_contentLoader == nullptr)
+			return;
+
+		std::vector<FileData> batch;
+		bool done = false;
+		{
+			std::lock_guard<std::mutex> lock(m_contentLoader->Mutex);
+			batch.swap(m_contentLoader->Batch);
+			done = m_contentLoader->Done;
+		}
+
+		if (!batch.empty()) {
+			// keep the right-clicked entry when the content gets re-sorted
+			std::filesystem::path selectedItem;
+			if (m_selectedFileItem >= 0 && m_selectedFileItem < static_cast<int>(m_content.size()))
+				selectedItem = m_content[m_selectedFileItem].Path;
+
+			DirectoryListing& listing = m_listings[m_currentDirectory.string()];
+			size_t sortedCount = m_content.size();
+			for (auto& info : batch) {
+				listing.Entries.push_back(info);
+				if (m_matchesFilter(info))
+					m_content.push_back(std::move(info));
+			}
+
+			// the content is already sorted, only the new entries need to be sorted and merged in
+			bool ascending = m_sortDirection == ImGuiSortDirection_Ascending;
+			auto less = [&](const FileData& left, const FileData& right) { return ContentLess(left, right, m_sortColumn, ascending); };
+			std::stable_sort(m_content.begin() + sortedCount, m_content.end(), less);
+			std::inplace_merge(m_content.begin(), m_content.begin() + sortedCount, m_content.end(), less);
+
+			if (!selectedItem.empty()) {
+				for (size_t i = 0; i < m_content.size(); i++)
+					if (m_content[i].Path == selectedItem) {
+						m_selectedFileItem = static_cast<int>(i);
+						break;
 					}
-				node->Read = true;
 			}
+		}
 
-			// display children
-			for (auto c : node->Children)
-				m_renderTree(c);
+		if (done) {
+			m_listings[m_currentDirectory.string()].Complete = true;
+			m_stopContentLoader();
+		}
+	}
+	void FileDialog::m_sortContent(unsigned int column, unsigned int sortDirection)
+	{
+		// 0 -> name, 1 -> date, 2 -> size
+		m_sortColumn = column;
+		m_sortDirection = sortDirection;
+
+		// sort the indices using the keys precomputed in FileData, then move each entry into place once
+		m_sortIndices.resize(m_content.size());
+		for (size_t i = 0; i < m_sortIndices.size(); i++)
+			m_sortIndices[i] = static_cast<uint32_t>(i);
+
+		bool ascending = sortDirection == ImGuiSortDirection_Ascending;
+		std::stable_sort(m_sortIndices.begin(), m_sortIndices.end(), [&](uint32_t l, uint32_t r) -> bool {
+			return ContentLess(m_content[l], m_content[r], column, ascending);
+		});
+
+		// apply the permutation by following its cycles
+		for (size_t i = 0; i < m_sortIndices.size(); i++) {
+			if (m_sortIndices[i] == i)
+				continue;
 
-			ImGui::TreePop();
+			FileData first = std::move(m_content[i]);
+			size_t current = i;
+			while (true) {
+				size_t next = m_sortIndices[current];
+				m_sortIndices[current] = static_cast<uint32_t>(current);
+				if (next == i) {
+					m_content[current] = std::move(first);
+					break;
+				}
+				m_content[current] = std::move(m_content[next]);
+				current = next;
+			}
 		}
-		if (isClicked)
-			m_setDirectory(node->Path);
-		ImGui::PopID();
+	}
+
+	void FileDialog::m_renderTree()
+	{
+		m_pollTree();
+
+		// the expanded part of the tree is flattened first, so that only the rows which are scrolled into view are submitted
+		m_treeRows.clear();
+		for (FileTreeNode* node : m_treeCache)
+			m_flattenTree(node, 0);
+
+		FileTreeNode* clickedNode = nullptr;
+		float indent = ImGui::GetStyle().IndentSpacing;
+		float startX = ImGui::GetCursorPosX();
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(m_treeRows.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+				FileTreeNode* node = m_treeRows[i].first;
+				ImGui::SetCursorPosX(startX + m_treeRows[i].second * indent);
+				ImGui::PushID(node);
+				bool wasOpen = node->Open;
+				if (FolderNode(node->DisplayName.c_str(), (ImTextureID)m_getIcon(node->Path), node->Open, node->PendingListing != nullptr))
+					clickedNode = node;
+				if (node->Open && !wasOpen)
+					m_expandTreeNode(node);
+				ImGui::PopID();
+			}
+		}
+
+		// keep the spinners turning
+		if (!m_loadingTreeNodes.empty() && RequestRedraw)
+			RequestRedraw();
+
+		if (clickedNode != nullptr)
+			m_setDirectory(clickedNode->Path);
 	}
 	void FileDialog::m_renderContent()
 	{
 		if (ImGui::IsMouseClicked(ImGuiMouseButton_Right))
 			m_selectedFileItem = -1;
 
+		m_pollContentLoader();
+		if (m_contentLoader != nullptr && m_content.empty()) {
+			ImGui::TextDisabled("Loading...");
+			return;
+		}
+
+		int openItem = -1;
+
 		// table view
 		if (m_zoom == 1.0f) {
 			if (ImGui::BeginTable("##contentTable", 3, /*ImGuiTableFlags_Resizable |*/ ImGuiTableFlags_Sortable, ImVec2(0, -FLT_MIN))) {
@@ -1112,50 +1807,35 @@ namespace ifd {
                     }
 				}
 
-				// content
-				int fileId = 0;
-				for (auto& entry : m_content) {
-					std::string filename = entry.Path.filename().string();
-					if (filename.size() == 0)
-						filename = entry.Path.string(); // drive
-					
-					bool isSelected = std::count(m_selections.begin(), m_selections.end(), entry.Path);
-
-					ImGui::TableNextRow();
-
-					// file name
-					ImGui::TableSetColumnIndex(0);
-					ImGui::Image((ImTextureID)m_getIcon(entry.Path), ImVec2(ICON_SIZE, ICON_SIZE));
-					ImGui::SameLine();
-					if (ImGui::Selectable(filename.c_str(), isSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick)) {
-						std::error_code ec;
-						bool isDir = std::filesystem::is_directory(entry.Path, ec);
-
-						if (ImGui::IsMouseDoubleClicked(0)) {
-							if (isDir) {
-								m_setDirectory(entry.Path);
-								break;
-							} else
-								m_finalize(filename);
-						} else {
-							if ((isDir && m_type == IFD_DIALOG_DIRECTORY) || !isDir)
-								m_select(entry.Path, ImGui::GetIO().KeyCtrl);
-						}
+				// content, only the visible rows are submitted
+				ImGuiListClipper clipper;
+				clipper.Begin(static_cast<int>(m_content.size()));
+				while (clipper.Step()) {
+					for (int fileId = clipper.DisplayStart; fileId < clipper.DisplayEnd; fileId++) {
+						auto& entry = m_content[fileId];
+
+						ImGui::TableNextRow();
+						ImGui::PushID(fileId);
+
+						// file name
+						ImGui::TableSetColumnIndex(0);
+						ImGui::Image((ImTextureID)m_getIcon(entry.Path), ImVec2(ICON_SIZE, ICON_SIZE));
+						ImGui::SameLine();
+						if (ImGui::Selectable(entry.DisplayName.c_str(), entry.IsSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick))
+							openItem = fileId;
+						if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
+							m_selectedFileItem = fileId;
+
+						// date
+						ImGui::TableSetColumnIndex(1);
+						ImGui::TextUnformatted(entry.DateString.c_str());
+
+						// size
+						ImGui::TableSetColumnIndex(2);
+						ImGui::TextUnformatted(entry.SizeString.c_str());
+
+						ImGui::PopID();
 					}
-					if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
-						m_selectedFileItem = fileId;
-					fileId++;
-
-					// date
-					ImGui::TableSetColumnIndex(1);
-					auto tm = std::localtime(&entry.DateModified);
-					if (tm != nullptr)
-						ImGui::Text("%d/%d/%d %02d:%02d", tm->tm_mon + 1, tm->tm_mday, 1900 + tm->tm_year, tm->tm_hour, tm->tm_min);
-					else ImGui::Text("---");
-
-					// size
-					ImGui::TableSetColumnIndex(2);
-					ImGui::Text("%.3f KiB", entry.Size/1024.0f);
 				}
 
 				ImGui::EndTable();
@@ -1163,41 +1843,61 @@ namespace ifd {
 		}
 		// "icon" view
 		else {
-			// content
-			int fileId = 0;
-			for (auto& entry : m_content) {
-				if (entry.HasIconPreview && entry.IconPreviewData != nullptr) {
-					entry.IconPreview = this->CreateTexture(entry.IconPreviewData, entry.IconPreviewWidth, entry.IconPreviewHeight, 1);
-					stbi_image_free(entry.IconPreviewData);
-					entry.IconPreviewData = nullptr;
-				}
-
-				std::string filename = entry.Path.filename().string();
-				if (filename.size() == 0)
-					filename = entry.Path.string(); // drive
-
-				bool isSelected = std::count(m_selections.begin(), m_selections.end(), entry.Path);
+			const ImGuiStyle& style = ImGui::GetStyle();
+			const ImVec2 iconSize(32 + 16 * m_zoom, 32 + 16 * m_zoom);
+			const int columns = std::max<int>(1, static_cast<int>((ImGui::GetContentRegionAvail().x + style.ItemSpacing.x) / (iconSize.x + style.ItemSpacing.x)));
+			const int rows = (static_cast<int>(m_content.size()) + columns - 1) / columns;
+
+			bool showPreviews = m_zoom >= 5.0f;
+			std::vector<PreviewJob> previewJobs;
+			if (showPreviews)
+				m_uploadPreviews();
+
+			// content, only the visible rows of icons are submitted
+			ImGuiListClipper clipper;
+			clipper.Begin(rows, iconSize.y + style.ItemSpacing.y);
+			while (clipper.Step()) {
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+					for (int fileId = row * columns; fileId < std::min<int>((row + 1) * columns, static_cast<int>(m_content.size())); fileId++) {
+						auto& entry = m_content[fileId];
+
+						const IconPreview* preview = nullptr;
+						if (showPreviews && entry.IsImage) {
+							auto it = m_iconPreviews.find(entry.DisplayName);
+							if (it == m_iconPreviews.end())
+								previewJobs.push_back({ entry.DisplayName, entry.Path, entry.DateModified, entry.Size, 0 });
+							else if (it->second.Texture != nullptr)
+								preview = &it->second;
+						}
 
-				if (FileIcon(filename.c_str(), isSelected, entry.HasIconPreview ? entry.IconPreview : (ImTextureID)m_getIcon(entry.Path), ImVec2(32 + 16 * m_zoom, 32 + 16 * m_zoom), entry.HasIconPreview, entry.IconPreviewWidth, entry.IconPreviewHeight)) {
-					std::error_code ec;
-					bool isDir = std::filesystem::is_directory(entry.Path, ec);
+						if (fileId != row * columns)
+							ImGui::SameLine();
 
-					if (ImGui::IsMouseDoubleClicked(0)) {
-						if (isDir) {
-							m_setDirectory(entry.Path);
-							break;
-						}
-						else
-							m_finalize(filename);
-					}
-					else {
-						if ((isDir && m_type == IFD_DIALOG_DIRECTORY) || !isDir)
-							m_select(entry.Path, ImGui::GetIO().KeyCtrl);
+						ImGui::PushID(fileId);
+						if (FileIcon(entry.DisplayName.c_str(), entry.IsSelected, preview ? preview->Texture : (ImTextureID)m_getIcon(entry.Path), iconSize, preview != nullptr, preview ? preview->Width : 0, preview ? preview->Height : 0))
+							openItem = fileId;
+						if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
+							m_selectedFileItem = fileId;
+						ImGui::PopID();
 					}
 				}
-				if (ImGui::IsItemClicked(ImGuiMouseButton_Right))
-					m_selectedFileItem = fileId;
-				fileId++;
+			}
+
+			if (showPreviews)
+				m_requestPreviews(previewJobs);
+		}
+
+		// handled after the loop, since changing the directory replaces m_content
+		if (openItem != -1) {
+			const FileData& entry = m_content[openItem];
+			if (ImGui::IsMouseDoubleClicked(0)) {
+				if (entry.IsDirectory)
+					m_setDirectory(std::filesystem::path(entry.Path));
+				else
+					m_finalize(entry.DisplayName);
+			} else {
+				if ((entry.IsDirectory && m_type == IFD_DIALOG_DIRECTORY) || !entry.IsDirectory)
+					m_select(entry.Path, ImGui::GetIO().KeyCtrl);
 			}
 		}
 	}
@@ -1228,6 +1928,7 @@ namespace ifd {
 				if (ImGui::Button("Yes")) {
 					std::error_code ec;
 					std::filesystem::remove_all(data.Path, ec);
+					m_eraseListing(m_currentDirectory.string());
 					m_setDirectory(m_currentDirectory, false); // refresh
 					ImGui::CloseCurrentPopup();
 				}
@@ -1248,6 +1949,7 @@ namespace ifd {
 				out << "";
 				out.close();
 
+				m_eraseListing(m_currentDirectory.string());
 				m_setDirectory(m_currentDirectory, false); // refresh
 				m_newEntryBuffer[0] = 0;
 
@@ -1268,6 +1970,7 @@ namespace ifd {
 			if (ImGui::Button("OK")) {
 				std::error_code ec;
 				std::filesystem::create_directory(m_currentDirectory / std::string(m_newEntryBuffer), ec);
+				m_eraseListing(m_currentDirectory.string());
 				m_setDirectory(m_currentDirectory, false); // refresh
 				m_newEntryBuffer[0] = 0;
 				ImGui::CloseCurrentPopup();
@@ -1328,7 +2031,7 @@ namespace ifd {
 		ImGui::PopStyleColor();
 
 		if (ImGui::InputTextEx("##searchTB", "Search", m_searchBuffer, 128, ImVec2(-FLT_MIN, GUI_ELEMENT_SIZE), 0)) // TODO: no hardcoded literals
-			m_setDirectory(m_currentDirectory, false); // refresh
+			m_applySearch();
 
 
 
@@ -1342,8 +2045,7 @@ namespace ifd {
 			// the tree on the left side
 			ImGui::TableSetColumnIndex(0);
 			ImGui::BeginChild("##treeContainer", ImVec2(0, -bottomBarHeight));
-			for (auto node : m_treeCache)
-				m_renderTree(node);
+			m_renderTree();
 			ImGui::EndChild();
 			
 			// content on the right side
@@ -1,6 +1,11 @@
 #pragma once
 #include <ctime>
+#include <deque>
+#include <mutex>
+#include <memory>
 #include <stack>
+#include <atomic>
+#include <condition_variable>
 #include <string>
 #include <thread>
 #include <vector>
@@ -49,6 +54,16 @@ namespace ifd {
 
 		std::function<void*(uint8_t*, int, int, char)> CreateTexture; // char -> fmt -> { 0 = BGRA, 1 = RGBA }
 		std::function<void(void*)> DeleteTexture;
+		std::function<void()> RequestRedraw; // called from the loader threads whenever new entries or icon previews are ready, optional
+		std::filesystem::path PreviewCacheDirectory; // downscaled icon previews are stored here, empty to disable the disk cache
+		uint64_t PreviewCacheSizeLimit; // in bytes, the least recently used previews are removed when the preview workers start
+
+		// called for every directory whose listing is cached / no longer cached, optional. Report the changes with OnFilesChanged()
+		// to keep the cached listings up to date without reading the directories again.
+		std::function<void(const std::filesystem::path&)> WatchDirectory;
+		std::function<void(const std::filesystem::path&)> UnwatchDirectory;
+		// names of the entries which were created, deleted or modified in the watched directory, empty if anything could have changed
+		void OnFilesChanged(const std::filesystem::path& directory, const std::vector<std::string>& names);
 
 		class FileTreeNode {
 		public:
@@ -56,31 +71,51 @@ namespace ifd {
 			FileTreeNode(const std::wstring& path) {
 				Path = std::filesystem::path(path);
 				Read = false;
+				Open = false;
 			}
 #endif
 
 			FileTreeNode(const std::string& path) {
 				Path = std::filesystem::u8path(path);
 				Read = false;
+				Open = false;
 			}
 
 			std::filesystem::path Path;
-			bool Read;
+			std::string DisplayName;
+			bool Read; // Children were enumerated at least once
+			bool Open;
+			std::filesystem::file_time_type DateModified; // of Path, when Children were enumerated
 			std::vector<FileTreeNode*> Children;
+
+			// the children are enumerated on a detached thread whenever the node is expanded, set while that is in progress. The thread
+			// owns the listing together with the node, so that closing the dialog drops it instead of waiting for a slow directory.
+			struct Listing {
+				bool Changed; // false if the directory wasn't modified since the last time, Children is empty then
+				std::filesystem::file_time_type DateModified;
+				std::vector<std::filesystem::path> Children;
+				std::atomic<bool> Done = false; // the fields above may be read once this is set
+				std::atomic<bool> Cancelled = false; // the dialog doesn't want the listing anymore
+			};
+			std::shared_ptr<Listing> PendingListing;
 		};
 		class FileData {
 		public:
 			FileData(const std::filesystem::path& path);
+			bool IsOutdated() const; // stats the file again, true if its type, size or date changed
 
 			std::filesystem::path Path;
 			bool IsDirectory;
 			size_t Size;
 			time_t DateModified;
 
-			bool HasIconPreview;
-			void* IconPreview;
-			uint8_t* IconPreviewData;
-			int IconPreviewWidth, IconPreviewHeight;
+			// formatted once when the directory is read, so that rendering a row doesn't allocate
+			std::string DisplayName;
+			std::string DateString;
+			std::string SizeString;
+			std::string SearchName; // lowercase DisplayName
+			bool IsSelected;
+			bool IsImage; // can have an icon preview
 		};
 
 	private:
@@ -119,19 +154,88 @@ namespace ifd {
 		void m_refreshIconPreview();
 		void m_clearIconPreview();
 
-		std::thread* m_previewLoader;
-		bool m_previewLoaderRunning;
-		void m_stopPreviewLoader();
-		void m_loadPreview();
-
-		std::vector<FileTreeNode*> m_treeCache;
-		void m_clearTree(FileTreeNode* node);
-		void m_renderTree(FileTreeNode* node);
+		// icon previews of m_currentDirectory by file name, decoded by a pool of threads as the entries become visible
+		struct IconPreview {
+			void* Texture; // nullptr if the image couldn't be loaded
+			int Width, Height;
+		};
+		struct PreviewJob {
+			std::string Name;
+			std::filesystem::path Path;
+			time_t DateModified;
+			size_t Size;
+			unsigned int Generation;
+		};
+		struct PreviewResult {
+			std::string Name;
+			unsigned int Generation;
+			std::vector<uint8_t> Pixels; // RGBA, empty if the image couldn't be loaded
+			int Width, Height;
+		};
+		std::unordered_map<std::string, IconPreview> m_iconPreviews;
+		std::vector<std::thread> m_previewWorkers;
+		std::mutex m_previewMutex;
+		std::condition_variable m_previewCondition;
+		std::deque<PreviewJob> m_previewJobs; // replaced every frame by the visible entries which still need a preview
+		std::vector<std::string> m_previewsInProgress;
+		std::vector<PreviewResult> m_previewResults;
+		bool m_previewWorkersRunning;
+		unsigned int m_previewGeneration; // results of older generations belong to another directory
+		void m_requestPreviews(std::vector<PreviewJob>& jobs);
+		void m_uploadPreviews();
+		void m_stopPreviewWorkers();
+		void m_previewWorker(bool pruneCache);
+		void m_loadPreview(const PreviewJob& job, PreviewResult& result);
+
+		// all nodes live in m_treeNodes until the dialog is closed, the deque never moves them
+		std::deque<FileTreeNode> m_treeNodes;
+		std::vector<FileTreeNode*> m_treeCache; // root nodes
+		std::vector<FileTreeNode*> m_loadingTreeNodes;
+		std::vector<std::pair<FileTreeNode*, int>> m_treeRows; // expanded part of the tree with the depth of each node, rebuilt every frame
+		FileTreeNode* m_newTreeNode(const std::filesystem::path& path);
+		void m_buildTree();
+		void m_expandTreeNode(FileTreeNode* node);
+		void m_pollTree();
+		void m_cancelTreeListings();
+		void m_flattenTree(FileTreeNode* node, int depth);
+		void m_renderTree();
 
 		unsigned int m_sortColumn;
 		unsigned int m_sortDirection;
+		std::vector<uint32_t> m_sortIndices; // reused by m_sortContent
 		std::vector<FileData> m_content;
 		void m_setDirectory(const std::filesystem::path& p, bool addHistory = true);
+		bool m_matchesFilter(const FileData& info);
+
+		// unfiltered contents of the recently visited directories, reused while their modification time doesn't change. Writing to a
+		// file doesn't change it, so the entries are stat'ed again whenever a listing is reused
+		struct DirectoryListing {
+			std::filesystem::file_time_type DateModified;
+			bool Complete;
+			bool Watched;
+			unsigned int LastUsed;
+			std::vector<FileData> Entries;
+		};
+		std::unordered_map<std::string, DirectoryListing> m_listings;
+		unsigned int m_listingUseCount;
+		void m_trimListings();
+		void m_eraseListing(const std::string& directory);
+
+		std::string m_searchQuery; // lowercase m_searchBuffer, as applied to m_content
+		void m_applySearch();
+
+		// the directory is read on a detached thread, which hands over the entries in batches. The thread owns the loader together with
+		// the dialog, so that leaving a slow directory drops it instead of waiting for the thread.
+		struct ContentLoader {
+			std::atomic<bool> Cancelled = false;
+			std::mutex Mutex;
+			std::vector<FileData> Batch;
+			bool Done = false;
+		};
+		std::shared_ptr<ContentLoader> m_contentLoader;
+		void m_stopContentLoader();
+		static void m_loadContent(std::shared_ptr<ContentLoader> loader, std::filesystem::path directory, std::function<void()> requestRedraw);
+		void m_pollContentLoader();
 		void m_sortContent(unsigned int column, unsigned int sortDirection);
 		void m_renderContent();
 
@@ -0,0 +1,101 @@
+#include "LogCapture.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <utility>
+
+namespace {
+    struct Node {
+        LogCapture::Message message;
+        Node* next = nullptr;
+    };
+
+    // The messages not taken yet, newest first.
+    std::atomic<Node*> g_head{ nullptr };
+    std::function<void()> g_on_message;
+    thread_local std::string g_source;
+
+    bool IsNameChar(char c) {
+        return std::isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.' || (unsigned char)c >= 0x80;
+    }
+
+    // The zero based line of a number such as "12" or "line 12" at the position, or -1.
+    int ParseLine(const std::string& text, size_t position) {
+        if (text.compare(position, 5, "line ") == 0 || text.compare(position, 5, "Line ") == 0)
+            position += 5;
+        int line = 0;
+        size_t digits = 0;
+        for (; position < text.size() && std::isdigit((unsigned char)text[position]) && digits < 9; position++, digits++)
+            line = line * 10 + (text[position] - '0');
+        return digits > 0 && line > 0 ? line - 1 : -1;
+    }
+}
+
+void LogCapture::SetCallback(std::function<void()> on_message) {
+    g_on_message = std::move(on_message);
+}
+
+void LogCapture::Push(Rml::Log::Type type, const std::string& text) {
+    Node* node = new Node;
+    node->message.type = type;
+    node->message.text = text;
+    node->message.source = g_source;
+    node->next = g_head.load(std::memory_order_relaxed);
+    while (!g_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    if (g_on_message)
+        g_on_message();
+}
+
+bool LogCapture::Pop(std::vector<Message>& messages) {
+    messages.clear();
+    Node* node = g_head.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        messages.push_back(std::move(node->message));
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+    std::reverse(messages.begin(), messages.end());
+    return !messages.empty();
+}
+
+bool LogCapture::FindLocation(const std::string& text, const std::string& path, int& line) {
+    const std::filesystem::path file = std::filesystem::u8path(path);
+    const std::string names[] = { path, file.generic_string(), file.filename().string() };
+    for (const std::string& name : names) {
+        if (name.empty())
+            continue;
+        for (size_t found = text.find(name); found != std::string::npos; found = text.find(name, found + 1)) {
+            size_t end = found + name.size();
+            if ((found > 0 && IsNameChar(text[found - 1])) || (end < text.size() && IsNameChar(text[end]) && text[end] != '.'))
+                continue;
+
+            // Such as "file.rcss:12", "file.rcss: 12." or "file.rcss, line 12".
+            while (end < text.size() && (text[end] == ':' || text[end] == ',' || text[end] == ' ' || text[end] == '('))
+                end++;
+            line = ParseLine(text, end);
+            return true;
+        }
+    }
+    return false;
+}
+
+int LogCapture::FindLine(const std::string& text) {
+    for (const char* word : { "line ", "Line " }) {
+        for (size_t found = text.find(word); found != std::string::npos; found = text.find(word, found + 1)) {
+            const int line = ParseLine(text, found);
+            if (line >= 0)
+                return line;
+        }
+    }
+    return -1;
+}
+
+LogCapture::SourceScope::SourceScope(const std::string& source) : m_previous(std::exchange(g_source, source)) {
+}
+
+LogCapture::SourceScope::~SourceScope() {
+    g_source = std::move(m_previous);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <RmlUi/Core/Log.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Collects the messages logged by RmlUi so that they can be shown next to the source they are about.
+//
+// Messages are pushed onto a lock-free list from whichever thread logs them, and the main thread takes all of them at once. Each message
+// remembers the document which was being loaded or updated on its thread at the time, see SourceScope, and the line is looked up in its
+// text afterwards, so logging itself stays cheap.
+namespace LogCapture {
+    struct Message {
+        Rml::Log::Type type = Rml::Log::LT_INFO;
+        std::string text;
+        // Source URL of the document being processed when the message was logged, empty if none.
+        std::string source;
+    };
+
+    // Called after every message, from the thread logging it. Set once before RmlUi is initialised.
+    void SetCallback(std::function<void()> on_message);
+
+    // May be called from any thread.
+    void Push(Rml::Log::Type type, const std::string& text);
+    // Takes the messages logged since the last call, oldest first. Returns false if there are none.
+    bool Pop(std::vector<Message>& messages);
+
+    // Returns true if the message refers to the file, and sets line to the zero based line it names or -1. The file is recognized by its
+    // path or its name.
+    bool FindLocation(const std::string& text, const std::string& path, int& line);
+    // The zero based line named by "line 12" within the message, or -1.
+    int FindLine(const std::string& text);
+
+    // Attributes the messages logged on this thread during its lifetime to the source.
+    class SourceScope {
+    public:
+        explicit SourceScope(const std::string& source);
+        ~SourceScope();
+
+        SourceScope(const SourceScope&) = delete;
+        SourceScope& operator=(const SourceScope&) = delete;
+
+    private:
+        std::string m_previous;
+    };
+}
@@ -0,0 +1,286 @@
+#include "Preview.h"
+#include "LogCapture.h"
+#include "RmlUi_Backend.h"
+#include "RmlUi_Renderer_GL3.h"
+#include <RmlUi/Core.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <imgui.h>
+
+namespace {
+    double GetTime() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int GetKeyModifiers(const ImGuiIO& io) {
+        int modifiers = 0;
+        if (io.KeyCtrl)
+            modifiers |= Rml::Input::KM_CTRL;
+        if (io.KeyShift)
+            modifiers |= Rml::Input::KM_SHIFT;
+        if (io.KeyAlt)
+            modifiers |= Rml::Input::KM_ALT;
+        if (io.KeySuper)
+            modifiers |= Rml::Input::KM_META;
+        return modifiers;
+    }
+
+    Rml::Input::KeyIdentifier ConvertKey(ImGuiKey key) {
+        using namespace Rml::Input;
+        if (key >= ImGuiKey_A && key <= ImGuiKey_Z)
+            return KeyIdentifier(KI_A + (key - ImGuiKey_A));
+        if (key >= ImGuiKey_0 && key <= ImGuiKey_9)
+            return KeyIdentifier(KI_0 + (key - ImGuiKey_0));
+        if (key >= ImGuiKey_F1 && key <= ImGuiKey_F12)
+            return KeyIdentifier(KI_F1 + (key - ImGuiKey_F1));
+
+        switch (key) {
+        case ImGuiKey_Tab: return KI_TAB;
+        case ImGuiKey_LeftArrow: return KI_LEFT;
+        case ImGuiKey_RightArrow: return KI_RIGHT;
+        case ImGuiKey_UpArrow: return KI_UP;
+        case ImGuiKey_DownArrow: return KI_DOWN;
+        case ImGuiKey_PageUp: return KI_PRIOR;
+        case ImGuiKey_PageDown: return KI_NEXT;
+        case ImGuiKey_Home: return KI_HOME;
+        case ImGuiKey_End: return KI_END;
+        case ImGuiKey_Insert: return KI_INSERT;
+        case ImGuiKey_Delete: return KI_DELETE;
+        case ImGuiKey_Backspace: return KI_BACK;
+        case ImGuiKey_Space: return KI_SPACE;
+        case ImGuiKey_Enter: return KI_RETURN;
+        case ImGuiKey_KeypadEnter: return KI_NUMPADENTER;
+        case ImGuiKey_Escape: return KI_ESCAPE;
+        default: break;
+        }
+        return KI_UNKNOWN;
+    }
+
+    // Several previews can share a window, only the last one clicked receives keyboard input.
+    const Preview* keyboard_preview = nullptr;
+    Preview* active_preview = nullptr;
+}
+
+Preview::Preview(RenderInterface_GL3* render_interface, float dp_ratio) : m_render_interface(render_interface), m_dp_ratio(dp_ratio) {
+    // Context names must be unique, the size is set once the preview is drawn.
+    static int preview_count = 0;
+    m_context = Rml::CreateContext("preview-" + std::to_string(++preview_count), Rml::Vector2i(1, 1));
+    if (m_context)
+        m_context->SetDensityIndependentPixelRatio(dp_ratio);
+}
+
+Preview::~Preview() {
+    if (keyboard_preview == this)
+        keyboard_preview = nullptr;
+    if (active_preview == this)
+        active_preview = nullptr;
+    m_render_interface->ReleaseRenderTarget(m_target);
+    if (m_context)
+        Rml::RemoveContext(m_context->GetName());
+}
+
+bool Preview::Load(const std::string& source, const std::string& source_url) {
+    if (!m_context)
+        return false;
+
+    if (m_document) {
+        m_document->Close();
+        m_document = nullptr;
+    }
+    m_dirty = true;
+    m_source_url = source_url;
+
+    LogCapture::SourceScope log_source(m_source_url);
+    m_document = m_context->LoadDocumentFromMemory(source, source_url);
+    if (!m_document)
+        return false;
+
+    m_document->Show();
+    return true;
+}
+
+Preview* Preview::GetActive() {
+    return active_preview;
+}
+
+void Preview::SetActive() {
+    active_preview = this;
+}
+
+bool Preview::IsVisible() const {
+    return m_drawn_frame == ImGui::GetFrameCount();
+}
+
+void Preview::SetFixedSize(const Rml::Vector2i& size) {
+    m_fixed_size = size;
+}
+
+void Preview::Draw(float width, float height) {
+    // Catch up with anything that happened while the preview was suspended.
+    if (m_drawn_frame != ImGui::GetFrameCount() - 1)
+        m_dirty = true;
+    m_drawn_frame = ImGui::GetFrameCount();
+
+    m_focused = ImGui::IsWindowFocused() && keyboard_preview == this;
+    if (!m_context)
+        return;
+
+    const ImGuiIO& io = ImGui::GetIO();
+    const ImVec2 region = (width > 0.f && height > 0.f) ? ImVec2(width, height) : ImGui::GetContentRegionAvail();
+    const ImVec2 framebuffer_scale = io.DisplayFramebufferScale;
+
+    Rml::Vector2i size = m_fixed_size;
+    ImVec2 display_size = region;
+    if (size.x <= 0 || size.y <= 0) {
+        size = Rml::Vector2i((int)(region.x * framebuffer_scale.x), (int)(region.y * framebuffer_scale.y));
+    }
+    else {
+        const float fit = std::min(region.x / size.x, region.y / size.y);
+        display_size = ImVec2(size.x * fit, size.y * fit);
+    }
+    if (size.x <= 0 || size.y <= 0 || display_size.x <= 0.f || display_size.y <= 0.f)
+        return;
+
+    if (size != m_size || !m_target)
+        Resize(size);
+    if (!m_target)
+        return;
+
+    // The render target is stored bottom-up.
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::Image((ImTextureID)m_render_interface->GetRenderTargetTexture(m_target), display_size, ImVec2(0, 1), ImVec2(1, 0));
+
+    // Claim the mouse over the image, so that dragging in the document doesn't move the window.
+    ImGui::SetCursorScreenPos(origin);
+    ImGui::InvisibleButton("##preview_input", display_size,
+        ImGuiButtonFlags_MouseButtonLeft | ImGuiButtonFlags_MouseButtonRight | ImGuiButtonFlags_MouseButtonMiddle);
+
+    if (ImGui::IsItemClicked(0) || ImGui::IsItemClicked(1) || ImGui::IsItemClicked(2)) {
+        keyboard_preview = this;
+        m_focused = ImGui::IsWindowFocused();
+    }
+
+    ProcessInput(origin.x, origin.y, size.x / display_size.x, size.y / display_size.y);
+}
+
+bool Preview::Update() {
+    if (!m_context || !IsVisible())
+        return false;
+
+    if (m_context->GetDensityIndependentPixelRatio() != m_dp_ratio) {
+        m_dp_ratio = m_context->GetDensityIndependentPixelRatio();
+        m_dirty = true;
+    }
+
+    const double now = GetTime();
+    if (now >= m_update_due)
+        m_dirty = true;
+    if (!m_dirty)
+        return false;
+
+    {
+        LogCapture::SourceScope log_source(m_source_url);
+        m_context->Update();
+    }
+    m_dirty = false;
+    m_render_pending = true;
+
+    const double delay = m_context->GetNextUpdateDelay();
+    m_update_due = now + delay;
+    if (delay < std::numeric_limits<double>::infinity())
+        Backend::ScheduleRedraw(delay);
+    return true;
+}
+
+void Preview::Render(const std::string& label) {
+    if (!m_context || !m_target || !IsVisible())
+        return;
+
+    // Textures finishing to load only change the rendering, not the layout.
+    if (m_render_interface->WereTexturesUploaded())
+        m_render_pending = true;
+    if (!m_render_pending)
+        return;
+
+    m_render_interface->BeginRenderTarget(m_target);
+    m_render_interface->BeginGpuTimer(label);
+    m_context->Render();
+    m_render_interface->EndGpuTimer();
+    m_render_interface->EndRenderTarget();
+
+    m_render_pending = false;
+}
+
+void Preview::Resize(const Rml::Vector2i& size) {
+    m_render_interface->ReleaseRenderTarget(m_target);
+    m_target = m_render_interface->CreateRenderTarget(size.x, size.y);
+    m_size = size;
+    m_context->SetDimensions(size);
+    m_dirty = true;
+}
+
+void Preview::ProcessInput(float origin_x, float origin_y, float scale_x, float scale_y) {
+    const ImGuiIO& io = ImGui::GetIO();
+    const int modifiers = GetKeyModifiers(io);
+    const bool hovered = ImGui::IsItemHovered();
+    const bool dragging = m_buttons_down[0] || m_buttons_down[1] || m_buttons_down[2];
+
+    // Keep sending mouse moves while dragging outside of the preview, like a window would.
+    if (hovered || dragging) {
+        const Rml::Vector2i position((int)((io.MousePos.x - origin_x) * scale_x), (int)((io.MousePos.y - origin_y) * scale_y));
+        if (!m_hovered || position != m_mouse_position) {
+            m_context->ProcessMouseMove(position.x, position.y, modifiers);
+            m_mouse_position = position;
+            m_dirty = true;
+        }
+    }
+    else if (m_hovered) {
+        m_context->ProcessMouseLeave();
+        m_dirty = true;
+    }
+    m_hovered = hovered || dragging;
+
+    if (hovered && io.MouseWheel != 0.f) {
+        m_context->ProcessMouseWheel(-io.MouseWheel, modifiers);
+        m_dirty = true;
+    }
+
+    for (int button = 0; button < 3; button++) {
+        if (hovered && ImGui::IsMouseClicked(button)) {
+            m_context->ProcessMouseButtonDown(button, modifiers);
+            m_buttons_down[button] = true;
+            m_dirty = true;
+        }
+        if (m_buttons_down[button] && ImGui::IsMouseReleased(button)) {
+            m_context->ProcessMouseButtonUp(button, modifiers);
+            m_buttons_down[button] = false;
+            m_dirty = true;
+        }
+    }
+
+    if (!m_focused)
+        return;
+
+    for (int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_NamedKey_END; key++) {
+        const Rml::Input::KeyIdentifier identifier = ConvertKey((ImGuiKey)key);
+        if (identifier == Rml::Input::KI_UNKNOWN)
+            continue;
+        if (ImGui::IsKeyPressed((ImGuiKey)key)) {
+            m_context->ProcessKeyDown(identifier, modifiers);
+            m_dirty = true;
+        }
+        if (ImGui::IsKeyReleased((ImGuiKey)key)) {
+            m_context->ProcessKeyUp(identifier, modifiers);
+            m_dirty = true;
+        }
+    }
+
+    for (int i = 0; i < io.InputQueueCharacters.Size; i++) {
+        const ImWchar character = io.InputQueueCharacters[i];
+        if (character >= 32 && character != 127) {
+            m_context->ProcessTextInput((Rml::Character)character);
+            m_dirty = true;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <RmlUi/Core/Types.h>
+#include <cstdint>
+#include <string>
+
+class RenderInterface_GL3;
+
+// Shows an RML document in its own context, rendered into an offscreen target and displayed with ImGui::Image().
+//
+// The target is only re-rendered while the preview is dirty: after loading, resizing or changing the dp-ratio, after forwarding input to
+// the context, when textures finished loading, and when RmlUi asks for another update, e.g. during animations. The context itself is only
+// updated for the same reasons, so each preview runs at its own rate. A preview which was not drawn during the current ImGui frame, e.g.
+// because its window is closed or collapsed, is suspended and neither updated nor rendered.
+class Preview {
+public:
+    Preview(RenderInterface_GL3* render_interface, float dp_ratio);
+    ~Preview();
+
+    Preview(const Preview&) = delete;
+    Preview& operator=(const Preview&) = delete;
+
+    // Replaces the shown document. The source URL is used to resolve relative paths, such as linked style sheets.
+    bool Load(const std::string& source, const std::string& source_url);
+
+    // Draws the preview into a region of the given size, by default the remaining space of the current ImGui window, and forwards mouse and
+    // keyboard input to its context. A preview with a fixed size is scaled to fit the region.
+    void Draw(float width = 0.f, float height = 0.f);
+
+    // Updates the context if needed, call once per frame after building the ImGui windows. Returns true if the context was updated.
+    bool Update();
+    // Renders the context into the target if it changed since the last render, call between Backend::BeginFrame() and Backend::PresentFrame(). The label
+    // names the GPU timer of the render pass.
+    void Render(const std::string& label);
+
+    void MarkDirty() { m_dirty = true; }
+
+    // Renders the context at the given size in pixels instead of following the size of the region it is drawn into. Zero to follow it again.
+    void SetFixedSize(const Rml::Vector2i& size);
+
+    Rml::Context* GetContext() const { return m_context; }
+    // True if the preview received keyboard input during the last call to Draw(). That is the case when its window is focused and it was
+    // the last preview clicked in.
+    bool IsFocused() const { return m_focused; }
+    // False if the preview was not drawn during the current ImGui frame.
+    bool IsVisible() const;
+
+    // The most recently focused preview, whose context the debugger and the editor shortcuts follow. Null once that preview is destroyed.
+    static Preview* GetActive();
+    void SetActive();
+
+private:
+    void Resize(const Rml::Vector2i& size);
+    void ProcessInput(float origin_x, float origin_y, float scale_x, float scale_y);
+
+    RenderInterface_GL3* m_render_interface;
+    Rml::Context* m_context = nullptr;
+    Rml::ElementDocument* m_document = nullptr;
+    // Messages logged while loading or updating the document are attributed to it.
+    std::string m_source_url;
+
+    uintptr_t m_target = 0;
+    Rml::Vector2i m_size;
+    Rml::Vector2i m_fixed_size;
+    float m_dp_ratio = 1.f;
+    // Dirty previews are updated, after which their target is re-rendered.
+    bool m_dirty = true;
+    bool m_render_pending = false;
+    int m_drawn_frame = -1;
+    // Steady clock time in seconds at which RmlUi asked to be updated again.
+    double m_update_due = 0.0;
+
+    bool m_focused = false;
+    bool m_hovered = false;
+    bool m_buttons_down[3] = {};
+    Rml::Vector2i m_mouse_position;
+};
@@ -0,0 +1,82 @@
+#include "PreviewMatrix.h"
+#include "RmlUi_Backend.h"
+#include <chrono>
+#include <cmath>
+#include <fmt/format.h>
+#include <imgui.h>
+
+PreviewMatrix::PreviewMatrix(RenderInterface_GL3* render_interface, const std::vector<Resolution>& resolutions) {
+    for (const Resolution& resolution : resolutions) {
+        Cell cell;
+        cell.resolution = resolution;
+        cell.preview = std::make_unique<Preview>(render_interface, resolution.dp_ratio);
+        cell.preview->SetFixedSize(Rml::Vector2i((int)std::lround(resolution.width * resolution.dp_ratio),
+            (int)std::lround(resolution.height * resolution.dp_ratio)));
+        m_cells.push_back(std::move(cell));
+    }
+}
+
+std::vector<PreviewMatrix::Resolution> PreviewMatrix::GetDefaultResolutions() {
+    return {
+        { "Phone", 360, 640, 2.f },
+        { "Tablet", 768, 1024, 1.5f },
+        { "Laptop", 1366, 768, 1.f },
+        { "Desktop", 1920, 1080, 1.f },
+        { "Desktop HiDPI", 1280, 720, 2.f },
+    };
+}
+
+void PreviewMatrix::Load(const std::string& source, const std::string& source_url) {
+    for (Cell& cell : m_cells)
+        cell.preview->Load(source, source_url);
+}
+
+void PreviewMatrix::Draw() {
+    if (m_cells.empty())
+        return;
+
+    const ImVec2 available = ImGui::GetContentRegionAvail();
+    const float spacing = 8.f;
+    const int columns = (int)std::ceil(std::sqrt((float)m_cells.size()));
+    const int rows = ((int)m_cells.size() + columns - 1) / columns;
+    const float cell_width = (available.x - spacing * (columns - 1)) / columns;
+    const float cell_height = (available.y - spacing * (rows - 1)) / rows - ImGui::GetTextLineHeightWithSpacing();
+    if (cell_width <= 0.f || cell_height <= 0.f)
+        return;
+
+    for (size_t i = 0; i < m_cells.size(); i++) {
+        Cell& cell = m_cells[i];
+        if (i % columns != 0)
+            ImGui::SameLine(0.f, spacing);
+
+        ImGui::PushID((int)i);
+        ImGui::BeginGroup();
+        const Resolution& resolution = cell.resolution;
+        ImGui::Text("%s  %dx%d @ %gx", resolution.name.c_str(), resolution.width, resolution.height, resolution.dp_ratio);
+        cell.preview->Draw(cell_width, cell_height);
+        ImGui::Dummy(ImVec2(cell_width, 0.f));
+        ImGui::EndGroup();
+        ImGui::PopID();
+    }
+}
+
+void PreviewMatrix::Update(double budget_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < m_cells.size(); n++) {
+        const size_t index = (m_next_update + n) % m_cells.size();
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Leave the remaining cells for the next frame, which is requested right away.
+        if (n > 0 && elapsed_ms > budget_ms) {
+            m_next_update = index;
+            Backend::RequestRedraw();
+            return;
+        }
+        m_cells[index].preview->Update();
+    }
+}
+
+void PreviewMatrix::Render(const std::string& label) {
+    for (Cell& cell : m_cells)
+        cell.preview->Render(fmt::format("{} ({})", label, cell.resolution.name));
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Preview.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shows the same document at several sizes and dp-ratios side by side, each in its own preview.
+//
+// RmlUi keeps global state such as the font engine and style sheet caches, so the contexts cannot be updated on worker threads. Instead,
+// all cells are laid out within the same frame, spread over the following frames when they exceed the time budget per frame.
+class PreviewMatrix {
+public:
+    struct Resolution {
+        std::string name;
+        // Size in density-independent pixels, the context is sized in pixels at the dp-ratio.
+        int width;
+        int height;
+        float dp_ratio;
+    };
+
+    PreviewMatrix(RenderInterface_GL3* render_interface, const std::vector<Resolution>& resolutions = GetDefaultResolutions());
+
+    static std::vector<Resolution> GetDefaultResolutions();
+
+    void Load(const std::string& source, const std::string& source_url);
+
+    // Draws the cells in a grid filling the current ImGui window.
+    void Draw();
+    // Updates the dirty cells, starting where the previous frame ran out of time.
+    void Update(double budget_ms);
+    void Render(const std::string& label);
+
+private:
+    struct Cell {
+        Resolution resolution;
+        std::unique_ptr<Preview> preview;
+    };
+
+    std::vector<Cell> m_cells;
+    size_t m_next_update = 0;
+};
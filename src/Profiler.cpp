@@ -0,0 +1,267 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <imgui.h>
+
+namespace {
+    struct FrameRecord {
+        std::atomic<int64_t> stage_ns[(size_t)Profiler::Stage::Count];
+        int64_t frame_ns = 0;
+        int rml_draw_calls = 0;
+        int imgui_draw_calls = 0;
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+    };
+
+    FrameRecord g_frames[Profiler::kFrameHistory];
+    std::atomic<uint64_t> g_current_frame{ 0 };
+
+    std::chrono::steady_clock::time_point g_frame_start;
+    uint64_t g_frame_start_allocations = 0;
+    uint64_t g_frame_start_allocated_bytes = 0;
+    bool g_frame_open = false;
+
+    // Main thread only, see BeginStage().
+    std::chrono::steady_clock::time_point g_stage_start[(size_t)Profiler::Stage::Count];
+
+    // Updated by the global operator new below, which is only replaced with PROFILER_COUNT_ALLOCATIONS.
+    std::atomic<uint64_t> g_allocations{ 0 };
+    std::atomic<uint64_t> g_allocated_bytes{ 0 };
+
+    struct GpuSection {
+        double last_ms = 0.0;
+        double average_ms = 0.0;
+        double max_ms = 0.0;
+    };
+
+    bool g_gpu_timing_supported = false;
+    std::map<std::string, GpuSection> g_gpu_sections;
+
+    const char* const g_stage_names[(size_t)Profiler::Stage::Count] = {
+        "Process events", "ImGui", "Text editor", "Context update", "Context render", "Present frame"
+    };
+}
+
+#ifdef PROFILER_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    while (true) {
+        if (void* ptr = std::malloc(size == 0 ? 1 : size))
+            return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+void Profiler::BeginFrame() {
+    const uint64_t frame = g_current_frame.load(std::memory_order_relaxed) + (g_frame_open ? 0 : 1);
+    g_frame_open = true;
+    FrameRecord& record = g_frames[frame % kFrameHistory];
+    for (auto& stage : record.stage_ns)
+        stage.store(0, std::memory_order_relaxed);
+    g_current_frame.store(frame, std::memory_order_release);
+
+    g_frame_start = std::chrono::steady_clock::now();
+    g_frame_start_allocations = g_allocations.load(std::memory_order_relaxed);
+    g_frame_start_allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+void Profiler::EndFrame(int rml_draw_calls, int imgui_draw_calls) {
+    g_frame_open = false;
+    FrameRecord& record = g_frames[g_current_frame.load(std::memory_order_relaxed) % kFrameHistory];
+    record.frame_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_frame_start).count();
+    record.rml_draw_calls = rml_draw_calls;
+    record.imgui_draw_calls = imgui_draw_calls;
+    record.allocations = g_allocations.load(std::memory_order_relaxed) - g_frame_start_allocations;
+    record.allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed) - g_frame_start_allocated_bytes;
+}
+
+void Profiler::AddStageTime(Stage stage, int64_t nanoseconds) {
+    FrameRecord& record = g_frames[g_current_frame.load(std::memory_order_acquire) % kFrameHistory];
+    record.stage_ns[(size_t)stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void Profiler::BeginStage(Stage stage) {
+    g_stage_start[(size_t)stage] = std::chrono::steady_clock::now();
+}
+
+void Profiler::EndStage(Stage stage) {
+    AddStageTime(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_stage_start[(size_t)stage]).count());
+}
+
+bool Profiler::GetFrame(int frames_ago, FrameStats& out_stats) {
+    // The current frame is still being recorded, so start with the one before it.
+    const uint64_t current = g_current_frame.load(std::memory_order_acquire);
+    if (frames_ago < 0 || frames_ago >= kFrameHistory - 1 || (uint64_t)frames_ago + 1 >= current)
+        return false;
+
+    const FrameRecord& record = g_frames[(current - 1 - frames_ago) % kFrameHistory];
+    out_stats.frame_ns = record.frame_ns;
+    for (size_t i = 0; i < (size_t)Stage::Count; i++)
+        out_stats.stage_ns[i] = record.stage_ns[i].load(std::memory_order_relaxed);
+    out_stats.rml_draw_calls = record.rml_draw_calls;
+    out_stats.imgui_draw_calls = record.imgui_draw_calls;
+    out_stats.allocations = record.allocations;
+    out_stats.allocated_bytes = record.allocated_bytes;
+    return true;
+}
+
+const char* Profiler::GetStageName(Stage stage) {
+    return g_stage_names[(size_t)stage];
+}
+
+void Profiler::SetGpuTimingSupported(bool supported) {
+    g_gpu_timing_supported = supported;
+}
+
+void Profiler::AddGpuTimings(const std::vector<GpuTiming>& timings) {
+    // Sections are summed first, so that a name timed several times during a frame shows its total.
+    std::map<std::string, double> frame_ms;
+    for (const GpuTiming& timing : timings)
+        frame_ms[timing.name] += timing.milliseconds;
+
+    for (auto& [name, section] : g_gpu_sections) {
+        if (frame_ms.find(name) == frame_ms.end())
+            frame_ms[name] = 0.0;
+    }
+
+    for (const auto& [name, ms] : frame_ms) {
+        auto [it, inserted] = g_gpu_sections.try_emplace(name);
+        GpuSection& section = it->second;
+        section.last_ms = ms;
+        section.average_ms = inserted ? ms : section.average_ms + (ms - section.average_ms) * 0.05;
+        // The peak decays slowly so that a single spike does not stick around forever.
+        section.max_ms = inserted ? ms : std::max(ms, section.max_ms * 0.99);
+    }
+}
+
+void Profiler::RenderOverlay(bool* open) {
+    constexpr int kAverageFrames = 120;
+
+    ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    if (!ImGui::Begin("Profiler (F9)", open, ImGuiWindowFlags_NoFocusOnAppearing)) {
+        ImGui::End();
+        return;
+    }
+
+    // Rolling averages and maxima over the most recent frames.
+    FrameStats last;
+    double average_ms[(size_t)Stage::Count] = {};
+    double max_ms[(size_t)Stage::Count] = {};
+    float frame_ms[kAverageFrames] = {};
+    double average_frame_ms = 0.0;
+    int frame_count = 0;
+    FrameStats stats;
+    for (int i = 0; i < kAverageFrames && GetFrame(i, stats); i++) {
+        if (i == 0)
+            last = stats;
+        for (size_t s = 0; s < (size_t)Stage::Count; s++) {
+            double ms = stats.stage_ns[s] / 1e6;
+            average_ms[s] += ms;
+            if (ms > max_ms[s])
+                max_ms[s] = ms;
+        }
+        frame_ms[kAverageFrames - 1 - i] = (float)(stats.frame_ns / 1e6);
+        average_frame_ms += stats.frame_ns / 1e6;
+        frame_count++;
+    }
+    if (frame_count == 0) {
+        ImGui::TextUnformatted("Collecting frames...");
+        ImGui::End();
+        return;
+    }
+    for (double& ms : average_ms)
+        ms /= frame_count;
+    average_frame_ms /= frame_count;
+
+    ImGui::Text("Frame: %.2f ms avg (%.0f FPS) over %d frames", average_frame_ms, average_frame_ms > 0.0 ? 1000.0 / average_frame_ms : 0.0, frame_count);
+    ImGui::PlotLines("##frametimes", frame_ms + (kAverageFrames - frame_count), frame_count, 0, nullptr, 0.0f, 33.3f, ImVec2(-FLT_MIN, 50));
+
+    if (ImGui::BeginTable("##stages", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("Stage", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableHeadersRow();
+        for (size_t s = 0; s < (size_t)Stage::Count; s++) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            // The text editor renders inside the ImGui stage.
+            if ((Stage)s == Stage::TextEditor)
+                ImGui::Indent();
+            ImGui::TextUnformatted(GetStageName((Stage)s));
+            if ((Stage)s == Stage::TextEditor)
+                ImGui::Unindent();
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f", last.stage_ns[s] / 1e6);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", average_ms[s]);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.3f", max_ms[s]);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    if (!g_gpu_timing_supported) {
+        ImGui::TextDisabled("GPU timer queries are not supported, showing CPU times only.");
+    }
+    else if (ImGui::BeginTable("##gpu", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("GPU section", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Peak ms");
+        ImGui::TableHeadersRow();
+        for (const auto& [name, section] : g_gpu_sections) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(name.c_str());
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f", section.last_ms);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", section.average_ms);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.3f", section.max_ms);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Draw calls: %d RmlUi, %d ImGui", last.rml_draw_calls, last.imgui_draw_calls);
+#ifdef PROFILER_COUNT_ALLOCATIONS
+    ImGui::Text("Allocations: %llu (%.1f KiB)", (unsigned long long)last.allocations, last.allocated_bytes / 1024.0);
+#else
+    ImGui::TextDisabled("Allocations: not counted, configure with PROFILE_ALLOCATIONS=ON");
+#endif
+
+    ImGui::End();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight CPU profiler for the editor main loop.
+//
+// Scoped timers add their duration to the current frame of a fixed ring of frame records. The ring is only written with relaxed atomics, so
+// timers may also be used on worker threads without taking a lock. The overlay reads the completed frames behind the current one.
+namespace Profiler {
+    enum class Stage {
+        // Includes the time spent waiting for events when the main loop is idle.
+        ProcessEvents,
+        ImGui,
+        TextEditor,
+        ContextUpdate,
+        ContextRender,
+        PresentFrame,
+        Count
+    };
+
+    constexpr int kFrameHistory = 240;
+
+    struct FrameStats {
+        int64_t frame_ns = 0;
+        int64_t stage_ns[(size_t)Stage::Count] = {};
+        int rml_draw_calls = 0;
+        int imgui_draw_calls = 0;
+        // Only counted when built with PROFILER_COUNT_ALLOCATIONS, see the PROFILE_ALLOCATIONS option.
+        uint64_t allocations = 0;
+        uint64_t allocated_bytes = 0;
+    };
+
+    // Marks the start of a new frame in the ring. If the previous frame was never ended, e.g. because it was skipped, it is restarted instead.
+    void BeginFrame();
+    // Closes the current frame with the draw call counts submitted during it.
+    void EndFrame(int rml_draw_calls, int imgui_draw_calls);
+
+    void AddStageTime(Stage stage, int64_t nanoseconds);
+    // Markers for stages spanning code that shouldn't be wrapped in a scope, such as the main loop. Only call from the main thread, each
+    // stage is ended before it begins again.
+    void BeginStage(Stage stage);
+    void EndStage(Stage stage);
+
+    // Copies a completed frame, 0 being the most recent one. Returns false if the frame is not recorded yet.
+    bool GetFrame(int frames_ago, FrameStats& out_stats);
+
+    const char* GetStageName(Stage stage);
+
+    struct GpuTiming {
+        std::string name;
+        double milliseconds = 0.0;
+    };
+
+    // GPU times arrive a few frames late from the renderer, so they are kept apart from the frame ring. Only call from the main thread.
+    void SetGpuTimingSupported(bool supported);
+    void AddGpuTimings(const std::vector<GpuTiming>& timings);
+
+    // Draws the profiler window, call between ImGui::NewFrame() and ImGui::Render().
+    void RenderOverlay(bool* open);
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage stage) : m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            AddStageTime(m_stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Stage m_stage;
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
@@ -0,0 +1,359 @@
+#include "RmlOutline.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fmt/format.h>
+
+namespace {
+    // Elements whose content is text, tags within it aren't parsed.
+    const char* const kRawTextElements[] = { "script", "style" };
+
+    bool IsNameChar(char c) {
+        return std::isalnum((unsigned char)c) || c == '-' || c == '_' || c == ':' || c == '.' || (unsigned char)c >= 0x80;
+    }
+
+    bool IsBefore(const RmlOutline::Position& a, const RmlOutline::Position& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    }
+
+    // Parses text starting at origin within the document, which can be a part of it such as a single element.
+    class Parser {
+    public:
+        Parser(const std::string& text, RmlOutline::Position origin, int depth)
+            : m_text(text), m_origin(origin), m_depth(depth) {
+            m_line_starts.push_back(0);
+            for (size_t i = 0; i < text.size(); i++) {
+                if (text[i] == '\n')
+                    m_line_starts.push_back(i + 1);
+            }
+        }
+
+        void Run() {
+            while (m_position < m_text.size()) {
+                const size_t tag = m_text.find('<', m_position);
+                if (tag == std::string::npos)
+                    break;
+                m_position = tag;
+
+                if (StartsWith("<!--"))
+                    SkipTo(tag, "-->", "Comment is not closed");
+                else if (StartsWith("<![CDATA["))
+                    SkipTo(tag, "]]>", "CDATA section is not closed");
+                else if (StartsWith("<?"))
+                    SkipTo(tag, "?>", "Processing instruction is not closed");
+                else if (StartsWith("<!"))
+                    SkipTo(tag, ">", "Declaration is not closed");
+                else if (StartsWith("</"))
+                    ParseCloseTag();
+                else if (tag + 1 < m_text.size() && IsNameChar(m_text[tag + 1]))
+                    ParseOpenTag();
+                else {
+                    AddError(tag, "'<' doesn't start a tag, write &lt; instead");
+                    m_position++;
+                }
+            }
+
+            while (!m_open.empty()) {
+                const int index = m_open.back();
+                AddError(m_elements[index].open_start, fmt::format("<{}> is not closed", m_elements[index].name));
+                m_elements[index].size = (int)m_elements.size() - index;
+                m_open.pop_back();
+            }
+            std::stable_sort(m_errors.begin(), m_errors.end(), [](const RmlOutline::Error& a, const RmlOutline::Error& b) {
+                return IsBefore(a.position, b.position);
+            });
+        }
+
+        std::vector<RmlOutline::Element>& GetElements() { return m_elements; }
+        std::vector<RmlOutline::Error>& GetErrors() { return m_errors; }
+        // Close tags which matched none of the elements parsed, they could close an element enclosing the text.
+        bool HasUnmatchedCloseTags() const { return m_unmatched_close_tags; }
+
+    private:
+        bool StartsWith(const char* prefix) const {
+            return m_text.compare(m_position, std::strlen(prefix), prefix) == 0;
+        }
+
+        RmlOutline::Position At(size_t offset) const {
+            const size_t line = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset) - m_line_starts.begin() - 1;
+            RmlOutline::Position position;
+            position.line = m_origin.line + (int)line;
+            position.column = (int)(offset - m_line_starts[line]) + (line == 0 ? m_origin.column : 0);
+            return position;
+        }
+
+        void AddError(RmlOutline::Position position, std::string message) {
+            m_errors.push_back(RmlOutline::Error{ position, std::move(message) });
+        }
+        void AddError(size_t offset, std::string message) {
+            AddError(At(offset), std::move(message));
+        }
+
+        void SkipTo(size_t start, const char* terminator, const char* error) {
+            const size_t end = m_text.find(terminator, m_position);
+            if (end == std::string::npos) {
+                AddError(start, error);
+                m_position = m_text.size();
+            }
+            else
+                m_position = end + std::strlen(terminator);
+        }
+
+        std::string ReadName() {
+            const size_t start = m_position;
+            while (m_position < m_text.size() && IsNameChar(m_text[m_position]))
+                m_position++;
+            return m_text.substr(start, m_position - start);
+        }
+
+        void SkipSpace() {
+            while (m_position < m_text.size() && std::isspace((unsigned char)m_text[m_position]))
+                m_position++;
+        }
+
+        void ParseOpenTag() {
+            const size_t start = m_position;
+            m_position++;
+
+            RmlOutline::Element element;
+            element.name = ReadName();
+            element.depth = m_depth + (int)m_open.size();
+            element.open_start = At(start);
+
+            std::vector<std::string> attributes;
+            bool terminated = false;
+            while (true) {
+                SkipSpace();
+                if (m_position >= m_text.size() || m_text[m_position] == '<')
+                    break;
+                if (m_text[m_position] == '>') {
+                    m_position++;
+                    terminated = true;
+                    break;
+                }
+                if (StartsWith("/>")) {
+                    m_position += 2;
+                    element.empty = true;
+                    terminated = true;
+                    break;
+                }
+
+                const size_t name_start = m_position;
+                std::string name = ReadName();
+                if (name.empty()) {
+                    AddError(m_position, fmt::format("Unexpected '{}' in <{}>", m_text[m_position], element.name));
+                    m_position++;
+                    continue;
+                }
+                if (std::find(attributes.begin(), attributes.end(), name) != attributes.end())
+                    AddError(name_start, fmt::format("Duplicate attribute '{}'", name));
+
+                std::string value;
+                SkipSpace();
+                if (m_position < m_text.size() && m_text[m_position] == '=') {
+                    m_position++;
+                    SkipSpace();
+                    if (m_position < m_text.size() && (m_text[m_position] == '"' || m_text[m_position] == '\'')) {
+                        const size_t value_start = m_position + 1;
+                        const size_t value_end = m_text.find(m_text[m_position], value_start);
+                        if (value_end == std::string::npos) {
+                            AddError(m_position, fmt::format("Value of '{}' is not closed", name));
+                            m_position = m_text.size();
+                            break;
+                        }
+                        value = m_text.substr(value_start, value_end - value_start);
+                        m_position = value_end + 1;
+                    }
+                    else {
+                        const size_t value_start = m_position;
+                        while (m_position < m_text.size() && !std::isspace((unsigned char)m_text[m_position]) && m_text[m_position] != '>' &&
+                            m_text[m_position] != '<' && !StartsWith("/>"))
+                            m_position++;
+                        value = m_text.substr(value_start, m_position - value_start);
+                    }
+                }
+
+                if (name == "id")
+                    element.id = value;
+                else if (name == "class")
+                    element.classes = value;
+                attributes.push_back(std::move(name));
+            }
+
+            if (!terminated) {
+                AddError(start, fmt::format("<{}> tag is not closed", element.name));
+                element.empty = true;
+            }
+            element.open_end = At(m_position);
+
+            const int index = (int)m_elements.size();
+            if (element.empty) {
+                element.closed = terminated;
+                element.close_start = element.open_start;
+                element.close_end = element.open_end;
+                m_elements.push_back(std::move(element));
+                return;
+            }
+
+            // The text of raw elements runs up to their close tag, which is parsed as usual.
+            if (std::find(std::begin(kRawTextElements), std::end(kRawTextElements), element.name) != std::end(kRawTextElements)) {
+                const size_t close = m_text.find("</" + element.name, m_position);
+                m_position = close == std::string::npos ? m_text.size() : close;
+            }
+            m_elements.push_back(std::move(element));
+            m_open.push_back(index);
+        }
+
+        void ParseCloseTag() {
+            const size_t start = m_position;
+            m_position += 2;
+            const std::string name = ReadName();
+            SkipSpace();
+            if (m_position < m_text.size() && m_text[m_position] == '>')
+                m_position++;
+            else
+                AddError(start, fmt::format("</{}> tag is not closed", name));
+
+            auto open = std::find_if(m_open.rbegin(), m_open.rend(), [&](int index) { return m_elements[index].name == name; });
+            if (open == m_open.rend()) {
+                AddError(start, fmt::format("</{}> closes no element", name));
+                m_unmatched_close_tags = true;
+                return;
+            }
+
+            // The elements opened after the matching one end here as well.
+            const size_t count = open - m_open.rbegin() + 1;
+            for (size_t i = 0; i < count; i++) {
+                RmlOutline::Element& element = m_elements[m_open.back()];
+                element.size = (int)m_elements.size() - m_open.back();
+                if (i + 1 < count)
+                    AddError(element.open_start, fmt::format("<{}> is not closed", element.name));
+                else {
+                    element.closed = true;
+                    element.close_start = At(start);
+                    element.close_end = At(m_position);
+                }
+                m_open.pop_back();
+            }
+        }
+
+        const std::string& m_text;
+        RmlOutline::Position m_origin;
+        int m_depth;
+        std::vector<size_t> m_line_starts;
+        size_t m_position = 0;
+        std::vector<RmlOutline::Element> m_elements;
+        std::vector<RmlOutline::Error> m_errors;
+        std::vector<int> m_open;
+        bool m_unmatched_close_tags = false;
+    };
+}
+
+void RmlOutline::Parse(const TextEditor& editor) {
+    const std::string text = editor.GetText();
+    Parser parser(text, Position(), 0);
+    parser.Run();
+    m_elements = std::move(parser.GetElements());
+    m_errors = std::move(parser.GetErrors());
+}
+
+void RmlOutline::Update(const TextEditor& editor, int first, int last, int line_delta) {
+    // The elements around the edited lines, outermost first. Their open tags end before the first edited line and their close tags start
+    // after the last one, which was line last - line_delta before the edit. Elements which aren't closed can still contain some.
+    std::vector<int> path;
+    std::vector<size_t> enclosing;
+    int index = 0;
+    int end = (int)m_elements.size();
+    while (index < end) {
+        const Element& element = m_elements[index];
+        const bool encloses = element.closed && !element.empty && element.open_end.line < first && element.close_start.line > last - line_delta;
+        if (encloses || (!element.closed && element.size > 1)) {
+            if (encloses)
+                enclosing.push_back(path.size());
+            path.push_back(index);
+            end = index + element.size;
+            index++;
+        }
+        else
+            index += element.size;
+    }
+
+    // Where the edit changed which tags match, the element it is in ends elsewhere now and the enclosing one has to be parsed.
+    while (!enclosing.empty()) {
+        path.resize(enclosing.back() + 1);
+        if (Reparse(editor, path, first, last, line_delta))
+            return;
+        enclosing.pop_back();
+    }
+    Parse(editor);
+}
+
+bool RmlOutline::Reparse(const TextEditor& editor, const std::vector<int>& path, int first, int last, int line_delta) {
+    const int index = path.back();
+    const Element old = m_elements[index];
+    Position end = old.close_end;
+    end.line += line_delta;
+
+    std::string text;
+    for (int line = old.open_start.line; line <= end.line; line++) {
+        std::string line_text = editor.GetLineText(line);
+        if (line == end.line)
+            line_text.resize(std::min(line_text.size(), (size_t)end.column));
+        if (line == old.open_start.line)
+            line_text.erase(0, std::min(line_text.size(), (size_t)old.open_start.column));
+        else
+            text += '\n';
+        text += line_text;
+    }
+
+    Parser parser(text, old.open_start, old.depth);
+    parser.Run();
+    std::vector<Element>& elements = parser.GetElements();
+    if (parser.HasUnmatchedCloseTags() || elements.empty() || elements[0].name != old.name || !elements[0].closed ||
+        elements[0].size != (int)elements.size() || elements[0].close_end.line != end.line || elements[0].close_end.column != end.column)
+        return false;
+
+    // The rest of the document moves with the lines after the edit.
+    const int moved = last - line_delta;
+    auto move = [&](Position& position) {
+        if (position.line > moved)
+            position.line += line_delta;
+    };
+    for (int i = 0; i < (int)m_elements.size(); i++) {
+        if (i == index) {
+            i += old.size - 1;
+            continue;
+        }
+        move(m_elements[i].open_start);
+        move(m_elements[i].open_end);
+        move(m_elements[i].close_start);
+        move(m_elements[i].close_end);
+    }
+
+    m_errors.erase(std::remove_if(m_errors.begin(), m_errors.end(), [&](const Error& error) {
+        return !IsBefore(error.position, old.open_start) && IsBefore(error.position, old.close_end);
+    }), m_errors.end());
+    for (Error& error : m_errors)
+        move(error.position);
+    std::vector<Error>& errors = parser.GetErrors();
+    m_errors.insert(m_errors.end(), std::make_move_iterator(errors.begin()), std::make_move_iterator(errors.end()));
+    std::stable_sort(m_errors.begin(), m_errors.end(), [](const Error& a, const Error& b) { return IsBefore(a.position, b.position); });
+
+    const int size_delta = (int)elements.size() - old.size;
+    for (size_t i = 0; i + 1 < path.size(); i++)
+        m_elements[path[i]].size += size_delta;
+    m_elements.erase(m_elements.begin() + index, m_elements.begin() + index + old.size);
+    m_elements.insert(m_elements.begin() + index, std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+    return true;
+}
+
+TextEditor::ErrorMarkers RmlOutline::GetErrorMarkers() const {
+    TextEditor::ErrorMarkers markers;
+    for (const Error& error : m_errors) {
+        std::string& marker = markers[error.position.line + 1];
+        if (!marker.empty())
+            marker += '\n';
+        marker += error.message;
+    }
+    return markers;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "TextEditor.h"
+#include <string>
+#include <vector>
+
+// Structure of an RML document while it is edited: its elements with where their tags are, and the syntax errors found on the way.
+//
+// The parser doesn't stop at errors. Close tags end the innermost element of the same name and the elements still open within it are
+// reported as not closed, unterminated comments and tags end the document. After an edit only the innermost element around the edited
+// lines is parsed again and its subtree replaced, the rest of the elements are moved by the lines added or removed. The whole document is
+// only parsed when it is replaced, or when the edit changed which tags match so that the element no longer ends where it did.
+class RmlOutline {
+public:
+    struct Position {
+        // Zero based, the column is a character index.
+        int line = 0;
+        int column = 0;
+    };
+    struct Element {
+        std::string name;
+        std::string id;
+        std::string classes;
+        int depth = 0;
+        // Number of elements of the subtree including this one, they follow it.
+        int size = 1;
+        // From the '<' to after the '>'. The close tag of empty elements such as <br/> is their open tag.
+        Position open_start;
+        Position open_end;
+        Position close_start;
+        Position close_end;
+        bool closed = false;
+        bool empty = false;
+    };
+    struct Error {
+        Position position;
+        std::string message;
+    };
+
+    // Parses the whole text of the editor.
+    void Parse(const TextEditor& editor);
+    // Parses the changed lines again, see TextEditor::TakeChangedLines().
+    void Update(const TextEditor& editor, int first, int last, int line_delta);
+
+    // In document order, the parents before their children.
+    const std::vector<Element>& GetElements() const { return m_elements; }
+    const std::vector<Error>& GetErrors() const { return m_errors; }
+    TextEditor::ErrorMarkers GetErrorMarkers() const;
+
+private:
+    // Parses the last element of the path again, the others are the elements containing it.
+    bool Reparse(const TextEditor& editor, const std::vector<int>& path, int first, int last, int line_delta);
+
+    std::vector<Element> m_elements;
+    std::vector<Error> m_errors;
+};
@@ -62,6 +62,16 @@ bool ProcessEvents(Rml::Context* context, KeyDownCallback key_down_callback = nu
 // Request application closure during the next event processing call.
 void RequestExit();
 
+// Returns true if the next frame should be rendered, call after processing events. A frame is needed after any input event, when a redraw was
+// requested, or when the context, a scheduled redraw or an ImGui animation such as the text cursor blink is due. Outside of power-save mode
+// every frame is rendered.
+bool IsRedrawNeeded();
+// Requests that the next frame is rendered and wakes up the event processing if it is waiting. May be called from any thread, also after
+// Shutdown().
+void RequestRedraw();
+// Schedules a redraw after the given delay in seconds, the earliest scheduled redraw is kept. Only call from the main thread.
+void ScheduleRedraw(double delay);
+
 // Prepares the render state to accept rendering commands from RmlUi, call before rendering the RmlUi context.
 void BeginFrame();
 // Presents the rendered frame to the screen, call after rendering the RmlUi context.
@@ -33,7 +33,12 @@
 #include <RmlUi/Core/Input.h>
 #include <RmlUi/Core/Profiling.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
 #include <imgui.h>
+#include <imgui_internal.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include "ImFileDialog.h"
@@ -60,9 +65,60 @@ struct BackendData {
 	// Arguments set during event processing and nulled otherwise.
 	Rml::Context* context = nullptr;
 	KeyDownCallback key_down_callback = nullptr;
+
+	// Redraw scheduling for power-save mode. Times are in seconds as returned by glfwGetTime().
+	bool continuous_redraw = true;
+	int redraw_frames = 0;
+	double redraw_time = std::numeric_limits<double>::infinity();
+	double last_redraw_time = 0.0;
+	double last_input_time = 0.0;
 };
 static Rml::UniquePtr<BackendData> data;
 
+// Kept outside of the backend data since it can be set from other threads, such as the texture loader, while the backend shuts down.
+static std::atomic<bool> redraw_requested{true};
+// Worker threads may request a redraw at any time, GLFW must only be woken up between glfwInit() and glfwTerminate().
+static std::mutex glfw_alive_mutex;
+static bool glfw_alive = false;
+
+// ImGui settles hover and focus changes over a couple of frames, so input events are followed by more than a single frame.
+static constexpr int NumFramesAfterInput = 3;
+
+// Tooltips and the navigation highlight appear after a delay without further input, ImGui is redrawn at this interval until they settled.
+static constexpr double ImGuiDelayInterval = 0.1;
+static constexpr double ImGuiDelaySettleTime = 1.0;
+// Blink period of the text cursor and the part of it during which the cursor is shown, as in ImGui::InputTextEx().
+static constexpr float ImGuiCursorBlinkPeriod = 1.2f;
+static constexpr float ImGuiCursorBlinkVisible = 0.8f;
+
+static void OnInputEvent()
+{
+	data->redraw_frames = NumFramesAfterInput;
+	data->last_input_time = glfwGetTime();
+}
+
+// Schedules the redraws ImGui needs without any input, so that power-save mode doesn't freeze them. The text editor schedules its own cursor.
+// The ImGui state is that of the last frame, so the delays are relative to it.
+static void ScheduleImGuiRedraw()
+{
+	const ImGuiIO& io = ImGui::GetIO();
+	const double since_redraw = glfwGetTime() - data->last_redraw_time;
+
+	if (io.ConfigInputTextCursorBlink)
+	{
+		if (const ImGuiInputTextState* state = ImGui::GetInputTextState(ImGui::GetActiveID()))
+		{
+			// A negative time keeps the cursor visible after typing.
+			const float phase = state->CursorAnim <= 0.f ? state->CursorAnim : std::fmod(state->CursorAnim, ImGuiCursorBlinkPeriod);
+			const float next_edge = phase < ImGuiCursorBlinkVisible ? ImGuiCursorBlinkVisible - phase : ImGuiCursorBlinkPeriod - phase;
+			Backend::ScheduleRedraw(next_edge - since_redraw);
+		}
+	}
+
+	if ((ImGui::IsAnyItemHovered() || io.NavVisible) && data->last_redraw_time - data->last_input_time < ImGuiDelaySettleTime)
+		Backend::ScheduleRedraw(ImGuiDelayInterval - since_redraw);
+}
+
 bool Backend::Initialize(const char* name, int width, int height, bool allow_resize)
 {
 	RMLUI_ASSERT(!data);
@@ -71,6 +127,10 @@ bool Backend::Initialize(const char* name, int width, int height, bool allow_res
 
 	if (!glfwInit())
 		return false;
+	{
+		std::lock_guard<std::mutex> lock(glfw_alive_mutex);
+		glfw_alive = true;
+	}
 
 	// Set window hints for OpenGL 3.3 Core context creation.
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -112,6 +172,7 @@ bool Backend::Initialize(const char* name, int width, int height, bool allow_res
 	// The window size may have been scaled by DPI settings, get the actual pixel size.
 	glfwGetFramebufferSize(window, &width, &height);
 	data->render_interface.SetViewport(width, height);
+	data->render_interface.SetTextureLoadedCallback([]() { Backend::RequestRedraw(); });
 
 	// Receive num lock and caps lock modifiers for proper handling of numpad inputs in text fields.
 	glfwSetInputMode(window, GLFW_LOCK_KEY_MODS, GLFW_TRUE);
@@ -122,6 +183,8 @@ bool Backend::Initialize(const char* name, int width, int height, bool allow_res
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui::StyleColorsDark();
+    // The blink is kept going in power-save mode by ScheduleImGuiRedraw().
+    ImGui::GetIO().ConfigInputTextCursorBlink = true;
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 130");
 
@@ -146,6 +209,7 @@ bool Backend::Initialize(const char* name, int width, int height, bool allow_res
         GLuint texID = (GLuint)((uintptr_t)tex);
         glDeleteTextures(1, &texID);
     };
+    ifd::FileDialog::Instance().RequestRedraw = []() { Backend::RequestRedraw(); };
 	return true;
 }
 
@@ -155,6 +219,10 @@ void Backend::Shutdown()
 	glfwDestroyWindow(data->window);
 	data.reset();
 	RmlGL3::Shutdown();
+	{
+		std::lock_guard<std::mutex> lock(glfw_alive_mutex);
+		glfw_alive = false;
+	}
 	glfwTerminate();
 }
 
@@ -191,9 +259,33 @@ bool Backend::ProcessEvents(Rml::Context* context, KeyDownCallback key_down_call
 	data->context = context;
 	data->key_down_callback = key_down_callback;
 
-	if(power_save)
-		glfwWaitEventsTimeout(Rml::Math::Min(context->GetNextUpdateDelay(), 10.0));
-	else glfwPollEvents();
+	data->continuous_redraw = !power_save;
+	if (power_save)
+	{
+		ScheduleImGuiRedraw();
+
+		// The context update delay is relative to its last update, which happens right after a redraw is granted.
+		const double context_time = data->last_redraw_time + context->GetNextUpdateDelay();
+		const double timeout = Rml::Math::Min(context_time, data->redraw_time) - glfwGetTime();
+
+		if (data->redraw_frames > 0 || redraw_requested || timeout <= 0.0)
+			glfwPollEvents();
+		else if (timeout == std::numeric_limits<double>::infinity())
+			glfwWaitEvents();
+		else
+			glfwWaitEventsTimeout(timeout);
+
+		const double now = glfwGetTime();
+		if (now >= context_time || now >= data->redraw_time)
+		{
+			data->redraw_frames = Rml::Math::Max(data->redraw_frames, 1);
+			data->redraw_time = std::numeric_limits<double>::infinity();
+		}
+	}
+	else
+	{
+		glfwPollEvents();
+	}
 
 	data->context = nullptr;
 	data->key_down_callback = nullptr;
@@ -209,6 +301,38 @@ void Backend::RequestExit()
 	glfwSetWindowShouldClose(data->window, GLFW_TRUE);
 }
 
+bool Backend::IsRedrawNeeded()
+{
+	RMLUI_ASSERT(data);
+
+	bool result = data->continuous_redraw;
+	if (redraw_requested.exchange(false))
+		result = true;
+	if (data->redraw_frames > 0)
+	{
+		data->redraw_frames -= 1;
+		result = true;
+	}
+
+	if (result)
+		data->last_redraw_time = glfwGetTime();
+	return result;
+}
+
+void Backend::RequestRedraw()
+{
+	redraw_requested = true;
+	std::lock_guard<std::mutex> lock(glfw_alive_mutex);
+	if (glfw_alive)
+		glfwPostEmptyEvent();
+}
+
+void Backend::ScheduleRedraw(double delay)
+{
+	RMLUI_ASSERT(data);
+	data->redraw_time = Rml::Math::Min(data->redraw_time, glfwGetTime() + Rml::Math::Max(delay, 0.0));
+}
+
 void Backend::BeginFrame()
 {
 	RMLUI_ASSERT(data);
@@ -221,7 +345,9 @@ void Backend::PresentFrame()
     ImGui::Render();
 	RMLUI_ASSERT(data);
 	data->render_interface.EndFrame();
+	data->render_interface.BeginGpuTimer("ImGui");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	data->render_interface.EndGpuTimer();
 
 	glfwSwapBuffers(data->window);
 
@@ -235,6 +361,7 @@ static void SetupCallbacks(GLFWwindow* window)
 
 	// Key input
 	glfwSetKeyCallback(window, [](GLFWwindow* /*window*/, int glfw_key, int /*scancode*/, int glfw_action, int glfw_mods) {
+		OnInputEvent();
 		if (!data->context)
 			return;
 
@@ -272,30 +399,45 @@ static void SetupCallbacks(GLFWwindow* window)
 		}
 	});
 
-	glfwSetCharCallback(window, [](GLFWwindow* /*window*/, unsigned int codepoint) { RmlGLFW::ProcessCharCallback(data->context, codepoint); });
+	glfwSetCharCallback(window, [](GLFWwindow* /*window*/, unsigned int codepoint) {
+		OnInputEvent();
+		RmlGLFW::ProcessCharCallback(data->context, codepoint);
+	});
 
-	glfwSetCursorEnterCallback(window, [](GLFWwindow* /*window*/, int entered) { RmlGLFW::ProcessCursorEnterCallback(data->context, entered); });
+	glfwSetCursorEnterCallback(window, [](GLFWwindow* /*window*/, int entered) {
+		OnInputEvent();
+		RmlGLFW::ProcessCursorEnterCallback(data->context, entered);
+	});
 
 	// Mouse input
 	glfwSetCursorPosCallback(window, [](GLFWwindow* /*window*/, double xpos, double ypos) {
+		OnInputEvent();
 		RmlGLFW::ProcessCursorPosCallback(data->context, xpos, ypos, data->glfw_active_modifiers);
 	});
 
 	glfwSetMouseButtonCallback(window, [](GLFWwindow* /*window*/, int button, int action, int mods) {
+		OnInputEvent();
 		data->glfw_active_modifiers = mods;
 		RmlGLFW::ProcessMouseButtonCallback(data->context, button, action, mods);
 	});
 
 	glfwSetScrollCallback(window, [](GLFWwindow* /*window*/, double /*xoffset*/, double yoffset) {
+		OnInputEvent();
 		RmlGLFW::ProcessScrollCallback(data->context, yoffset, data->glfw_active_modifiers);
 	});
 
 	// Window events
 	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* /*window*/, int width, int height) {
+		OnInputEvent();
 		data->render_interface.SetViewport(width, height);
 		RmlGLFW::ProcessFramebufferSizeCallback(data->context, width, height);
 	});
 
-	glfwSetWindowContentScaleCallback(window,
-		[](GLFWwindow* /*window*/, float xscale, float /*yscale*/) { RmlGLFW::ProcessContentScaleCallback(data->context, xscale); });
+	glfwSetWindowContentScaleCallback(window, [](GLFWwindow* /*window*/, float xscale, float /*yscale*/) {
+		OnInputEvent();
+		RmlGLFW::ProcessContentScaleCallback(data->context, xscale);
+	});
+
+	glfwSetWindowFocusCallback(window, [](GLFWwindow* /*window*/, int /*focused*/) { OnInputEvent(); });
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow* /*window*/) { OnInputEvent(); });
 }
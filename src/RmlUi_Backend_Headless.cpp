@@ -0,0 +1,159 @@
+/*
+ * This source file is part of RmlUi, the HTML/CSS Interface Middleware
+ *
+ * For the latest information, see http://github.com/mikke89/RmlUi
+ *
+ * Copyright (c) 2008-2010 CodePoint Ltd, Shift Technology Ltd
+ * Copyright (c) 2019 The RmlUi Team, and contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "RmlUi_Backend.h"
+#include "RmlUi_Renderer_Recording.h"
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/Log.h>
+#include <RmlUi/Core/Profiling.h>
+#include <RmlUi/Core/SystemInterface.h>
+#include <chrono>
+#include <iostream>
+
+// In the editor target this is provided by ImFileDialog.cpp, which is not part of the headless backend.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+/**
+    A system interface without any window, used by the headless backend.
+
+    Log messages are written to stderr so that they do not interleave with the output of tools writing results to stdout.
+ */
+class SystemInterface_Headless : public Rml::SystemInterface {
+public:
+	SystemInterface_Headless() : start_time(std::chrono::steady_clock::now()) {}
+
+	double GetElapsedTime() override
+	{
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+		return elapsed.count();
+	}
+
+	void SetClipboardText(const Rml::String& text) override { clipboard = text; }
+	void GetClipboardText(Rml::String& text) override { text = clipboard; }
+
+	bool LogMessage(Rml::Log::Type type, const Rml::String& message) override
+	{
+		if (type <= Rml::Log::LT_WARNING)
+			std::cerr << message << "\n";
+		return true;
+	}
+
+private:
+	std::chrono::steady_clock::time_point start_time;
+	Rml::String clipboard;
+};
+
+/**
+    Global data used by this backend.
+
+    Lifetime governed by the calls to Backend::Initialize() and Backend::Shutdown().
+ */
+struct BackendData {
+	SystemInterface_Headless system_interface;
+	RenderInterface_Recording render_interface;
+	Rml::Vector2i dimensions;
+	bool context_dimensions_dirty = true;
+	bool running = true;
+};
+static Rml::UniquePtr<BackendData> data;
+
+bool Backend::Initialize(const char* /*window_name*/, int width, int height, bool /*allow_resize*/)
+{
+	RMLUI_ASSERT(!data);
+
+	data = Rml::MakeUnique<BackendData>();
+	data->dimensions = Rml::Vector2i(width, height);
+
+	return true;
+}
+
+void Backend::Shutdown()
+{
+	RMLUI_ASSERT(data);
+	data.reset();
+}
+
+Rml::SystemInterface* Backend::GetSystemInterface()
+{
+	RMLUI_ASSERT(data);
+	return &data->system_interface;
+}
+
+Rml::RenderInterface* Backend::GetRenderInterface()
+{
+	RMLUI_ASSERT(data);
+	return &data->render_interface;
+}
+
+bool Backend::ProcessEvents(Rml::Context* context, KeyDownCallback /*key_down_callback*/, bool /*power_save*/)
+{
+	RMLUI_ASSERT(data && context);
+
+	// There are no window events to process, only apply the initial dimensions to the context.
+	if (data->context_dimensions_dirty)
+	{
+		data->context_dimensions_dirty = false;
+		context->SetDimensions(data->dimensions);
+	}
+
+	const bool result = data->running;
+	data->running = true;
+	return result;
+}
+
+void Backend::RequestExit()
+{
+	RMLUI_ASSERT(data);
+	data->running = false;
+}
+
+bool Backend::IsRedrawNeeded()
+{
+	// Every frame is rendered, the caller decides how many it needs.
+	return true;
+}
+
+void Backend::RequestRedraw() {}
+
+void Backend::ScheduleRedraw(double /*delay*/) {}
+
+void Backend::BeginFrame()
+{
+	RMLUI_ASSERT(data);
+	data->render_interface.BeginFrame();
+}
+
+void Backend::PresentFrame()
+{
+	RMLUI_ASSERT(data);
+	data->render_interface.EndFrame();
+
+	// Optional, used to mark frames during performance profiling.
+	RMLUI_FrameMark;
+}
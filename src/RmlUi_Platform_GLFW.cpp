@@ -27,6 +27,7 @@
  */
 
 #include "RmlUi_Platform_GLFW.h"
+#include "LogCapture.h"
 #include <RmlUi/Core/Context.h>
 #include <RmlUi/Core/Input.h>
 #include <RmlUi/Core/Log.h>
@@ -100,6 +101,7 @@ void SystemInterface_GLFW::GetClipboardText(Rml::String& text)
 bool SystemInterface_GLFW::LogMessage(Rml::Log::Type type, const Rml::String& message)
 {
     std::cout << message << "\n";
+    LogCapture::Push(type, message);
     return false;
 }
 
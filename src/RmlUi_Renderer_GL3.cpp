@@ -31,7 +31,17 @@
 #include <RmlUi/Core/FileInterface.h>
 #include <RmlUi/Core/Log.h>
 #include <RmlUi/Core/Platform.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string.h>
+#include <thread>
+#include "stb_image.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define RMLUI_GL3_SSE2
+	#include <emmintrin.h>
+#endif
 
 #if defined(RMLUI_PLATFORM_WIN32) && !defined(__MINGW32__)
 	// function call missing argument list
@@ -113,6 +123,17 @@ struct CompiledGeometryData {
 	GLsizei draw_count;
 };
 
+// Persistent buffers that immediate-mode geometry is appended to, orphaned and restarted from the beginning when full.
+struct StreamingBufferData {
+	GLuint vao;
+	GLuint vbo;
+	GLuint ibo;
+	GLsizeiptr vertex_capacity;
+	GLsizeiptr vertex_offset;
+	GLsizeiptr index_capacity;
+	GLsizeiptr index_offset;
+};
+
 struct ProgramData {
 	GLuint id;
 	GLint uniform_locations[(size_t)ProgramUniform::Count];
@@ -313,6 +334,454 @@ static void DestroyShaders(ShadersData& shaders)
 	shaders = {};
 }
 
+#ifdef RMLUI_SRGB_PREMULTIPLIED_ALPHA
+	#ifdef RMLUI_GL3_SSE2
+// Multiplies the color channels of two RGBA pixels, widened to 16-bit lanes, by their alpha. Uses the exact rounding of x * a / 255.
+static inline __m128i PremultiplyTwoPixels(__m128i pixels)
+{
+	const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	const __m128i alpha_identity = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+	__m128i alpha = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+	// The alpha channel itself is multiplied by 255 so that it stays unchanged.
+	alpha = _mm_or_si128(_mm_andnot_si128(alpha_lanes, alpha), alpha_identity);
+
+	__m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+	#endif
+
+// Converts straight RGBA pixels to premultiplied alpha in-place.
+static void PremultiplyAlpha(Rml::byte* pixels, size_t num_pixels)
+{
+	size_t i = 0;
+	#ifdef RMLUI_GL3_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= num_pixels; i += 4)
+	{
+		__m128i* ptr = reinterpret_cast<__m128i*>(pixels + i * 4);
+		const __m128i src = _mm_loadu_si128(ptr);
+		const __m128i lo = PremultiplyTwoPixels(_mm_unpacklo_epi8(src, zero));
+		const __m128i hi = PremultiplyTwoPixels(_mm_unpackhi_epi8(src, zero));
+		_mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+	}
+	#endif
+	for (; i < num_pixels; i++)
+	{
+		Rml::byte* px = pixels + i * 4;
+		const unsigned int alpha = px[3];
+		for (int c = 0; c < 3; c++)
+		{
+			const unsigned int product = px[c] * alpha + 128;
+			px[c] = Rml::byte((product + (product >> 8)) >> 8);
+		}
+	}
+}
+#endif
+
+/**
+    Decodes image files on a small pool of worker threads.
+
+    The GL texture name is created up front with a transparent placeholder, so that RmlUi can use the handle immediately. The decoded pixels
+    are uploaded into the same texture name from the render thread during UploadFinished().
+ */
+class TextureLoader {
+public:
+	~TextureLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			shutdown = true;
+		}
+		condition.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+
+		for (Job& job : finished)
+			stbi_image_free(job.pixels);
+	}
+
+	void Enqueue(GLuint texture_id, Rml::Vector<Rml::byte>&& file_data, const Rml::String& source)
+	{
+		if (workers.empty())
+		{
+			const unsigned int num_workers = Rml::Math::Clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+			for (unsigned int i = 0; i < num_workers; i++)
+				workers.emplace_back(&TextureLoader::WorkerMain, this);
+		}
+
+		Job job;
+		job.texture_id = texture_id;
+		job.serial = ++last_serial;
+		job.file_data = std::move(file_data);
+		job.source = source;
+
+		pending[texture_id] = job.serial;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(job));
+		}
+		condition.notify_one();
+	}
+
+	// Must be set before any texture is enqueued.
+	void SetLoadedCallback(void (*callback)()) { loaded_callback = callback; }
+
+	// Discards the result of any job targeting the given texture, called when RmlUi releases the texture before it finished loading.
+	void Cancel(GLuint texture_id) { pending.erase(texture_id); }
+
+	bool IsPending() const { return !pending.empty(); }
+
+	bool UploadFinished()
+	{
+		Rml::Vector<Job> jobs;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (finished.empty())
+				return false;
+			jobs.swap(finished);
+		}
+
+		bool uploaded = false;
+		for (Job& job : jobs)
+		{
+			auto it = pending.find(job.texture_id);
+			if (it != pending.end() && it->second == job.serial)
+			{
+				pending.erase(it);
+				if (job.pixels)
+				{
+					glBindTexture(GL_TEXTURE_2D, job.texture_id);
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, job.width, job.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, job.pixels);
+					uploaded = true;
+				}
+				else
+				{
+					Rml::Log::Message(Rml::Log::LT_ERROR, "Failed to decode texture '%s'.", job.source.c_str());
+				}
+			}
+			stbi_image_free(job.pixels);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		CheckGLError("UploadFinished");
+
+		return uploaded;
+	}
+
+private:
+	struct Job {
+		GLuint texture_id = 0;
+		unsigned int serial = 0;
+		Rml::Vector<Rml::byte> file_data;
+		Rml::String source;
+
+		Rml::byte* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+	};
+
+	void WorkerMain()
+	{
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this] { return shutdown || !queue.empty(); });
+				if (shutdown)
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			int num_channels = 0;
+			job.pixels = stbi_load_from_memory(job.file_data.data(), (int)job.file_data.size(), &job.width, &job.height, &num_channels, STBI_rgb_alpha);
+			job.file_data = {};
+
+#ifdef RMLUI_SRGB_PREMULTIPLIED_ALPHA
+			// Grey-alpha and RGBA images are the only ones with an alpha channel to apply.
+			if (job.pixels && (num_channels == 2 || num_channels == 4))
+				PremultiplyAlpha(job.pixels, size_t(job.width) * size_t(job.height));
+#endif
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finished.push_back(std::move(job));
+			}
+
+			if (loaded_callback)
+				loaded_callback();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Job> queue;
+	Rml::Vector<Job> finished;
+	bool shutdown = false;
+	Rml::Vector<std::thread> workers;
+	void (*loaded_callback)() = nullptr;
+
+	// Only accessed from the render thread. Maps textures awaiting upload to the serial of their most recent job.
+	Rml::UnorderedMap<GLuint, unsigned int> pending;
+	unsigned int last_serial = 0;
+};
+
+static void SetupVertexAttributes(GLintptr base_offset)
+{
+	glEnableVertexAttribArray((GLuint)VertexAttribute::Position);
+	glVertexAttribPointer((GLuint)VertexAttribute::Position, 2, GL_FLOAT, GL_FALSE, sizeof(Rml::Vertex),
+		(const GLvoid*)(base_offset + offsetof(Rml::Vertex, position)));
+
+	glEnableVertexAttribArray((GLuint)VertexAttribute::Color0);
+	glVertexAttribPointer((GLuint)VertexAttribute::Color0, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Rml::Vertex),
+		(const GLvoid*)(base_offset + offsetof(Rml::Vertex, colour)));
+
+	glEnableVertexAttribArray((GLuint)VertexAttribute::TexCoord0);
+	glVertexAttribPointer((GLuint)VertexAttribute::TexCoord0, 2, GL_FLOAT, GL_FALSE, sizeof(Rml::Vertex),
+		(const GLvoid*)(base_offset + offsetof(Rml::Vertex, tex_coord)));
+}
+
+static void CreateStreamingBuffer(StreamingBufferData& out_buffer)
+{
+	out_buffer = {};
+	glGenVertexArrays(1, &out_buffer.vao);
+	glGenBuffers(1, &out_buffer.vbo);
+	glGenBuffers(1, &out_buffer.ibo);
+}
+
+static void DestroyStreamingBuffer(StreamingBufferData& buffer)
+{
+	glDeleteVertexArrays(1, &buffer.vao);
+	glDeleteBuffers(1, &buffer.vbo);
+	glDeleteBuffers(1, &buffer.ibo);
+	buffer = {};
+}
+
+// Appends data to the buffer bound to 'target' and returns its offset. When the buffer is full its storage is orphaned, so that the driver
+// can hand out fresh memory instead of waiting for draws still reading the old contents.
+static GLintptr StreamData(GLenum target, GLsizeiptr& capacity, GLsizeiptr& offset, const void* data, GLsizeiptr size)
+{
+	if (offset + size > capacity)
+	{
+		constexpr GLsizeiptr min_capacity = 64 * 1024;
+		capacity = Rml::Math::Max(Rml::Math::Max(capacity, min_capacity), size);
+		glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+		offset = 0;
+	}
+
+	const GLintptr result = offset;
+	glBufferSubData(target, result, size, data);
+	offset += size;
+	return result;
+}
+
+
+#if defined RMLUI_PLATFORM_EMSCRIPTEN
+
+// WebGL only exposes timer queries through an extension which is not loaded here.
+class GpuTimerQueries {
+public:
+	bool IsSupported() const { return false; }
+	void NextFrame() {}
+	void Begin(const Rml::String& /*name*/) {}
+	void End() {}
+	bool PopResults(Rml::Vector<RenderInterface_GL3::GpuTiming>& /*out_timings*/) { return false; }
+};
+
+#else
+
+/**
+    Measures GPU time of labelled sections with GL_TIME_ELAPSED queries.
+
+    Each frame records into its own slot of a small ring. A slot is read back when the ring wraps around to it, by which time the GPU has
+    normally finished with it. Results that are still not available are dropped rather than waited for, so the queries never stall the CPU.
+ */
+class GpuTimerQueries {
+public:
+	static constexpr int NumFrames = RenderInterface_GL3::GpuTimingLatency;
+
+	GpuTimerQueries()
+	{
+		// Some drivers, such as Mesa's llvmpipe, report a zero-bit counter when timer queries are not actually implemented.
+		GLint counter_bits = 0;
+		if (glGetQueryiv && glGenQueries)
+			glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &counter_bits);
+		supported = (counter_bits > 0);
+		// Clear any error raised by drivers that do not recognize the query target.
+		while (glGetError() != GL_NO_ERROR) {}
+	}
+
+	~GpuTimerQueries()
+	{
+		for (Frame& frame : frames)
+		{
+			for (Query& query : frame.queries)
+				glDeleteQueries(1, &query.id);
+		}
+	}
+
+	bool IsSupported() const { return supported; }
+
+	// Moves on to the next frame slot, reading back the timings of the frame previously recorded into it.
+	void NextFrame()
+	{
+		if (!supported)
+			return;
+
+		RMLUI_ASSERT(!active);
+		frame_index = (frame_index + 1) % NumFrames;
+		Frame& frame = frames[frame_index];
+
+		if (frame.num_used > 0)
+		{
+			bool available = true;
+			for (int i = 0; i < frame.num_used && available; i++)
+			{
+				GLint result_available = 0;
+				glGetQueryObjectiv(frame.queries[i].id, GL_QUERY_RESULT_AVAILABLE, &result_available);
+				available = (result_available != 0);
+			}
+
+			if (available)
+			{
+				resolved.clear();
+				for (int i = 0; i < frame.num_used; i++)
+				{
+					GLuint64 elapsed_ns = 0;
+					glGetQueryObjectui64v(frame.queries[i].id, GL_QUERY_RESULT, &elapsed_ns);
+					resolved.push_back(RenderInterface_GL3::GpuTiming{frame.queries[i].name, double(elapsed_ns) / 1.0e6});
+				}
+				has_new_results = true;
+			}
+		}
+
+		frame.num_used = 0;
+	}
+
+	void Begin(const Rml::String& name)
+	{
+		if (!supported)
+			return;
+
+		// GL_TIME_ELAPSED queries cannot be nested.
+		RMLUI_ASSERT(!active);
+		Frame& frame = frames[frame_index];
+		if (frame.num_used == (int)frame.queries.size())
+		{
+			Query query;
+			glGenQueries(1, &query.id);
+			frame.queries.push_back(std::move(query));
+		}
+
+		Query& query = frame.queries[frame.num_used++];
+		query.name = name;
+		glBeginQuery(GL_TIME_ELAPSED, query.id);
+		active = true;
+	}
+
+	void End()
+	{
+		if (!supported || !active)
+			return;
+
+		glEndQuery(GL_TIME_ELAPSED);
+		active = false;
+	}
+
+	bool PopResults(Rml::Vector<RenderInterface_GL3::GpuTiming>& out_timings)
+	{
+		if (!has_new_results)
+			return false;
+
+		out_timings.swap(resolved);
+		resolved.clear();
+		has_new_results = false;
+		return true;
+	}
+
+private:
+	struct Query {
+		GLuint id = 0;
+		Rml::String name;
+	};
+	struct Frame {
+		Rml::Vector<Query> queries;
+		int num_used = 0;
+	};
+
+	bool supported = false;
+	bool active = false;
+	int frame_index = 0;
+	Frame frames[NumFrames];
+
+	Rml::Vector<RenderInterface_GL3::GpuTiming> resolved;
+	bool has_new_results = false;
+};
+
+#endif
+
+struct RenderTargetData {
+	int width = 0;
+	int height = 0;
+	GLuint framebuffer = 0;
+	GLuint color_texture = 0;
+	GLuint depth_stencil_buffer = 0;
+};
+
+static void DestroyRenderTarget(RenderTargetData& target)
+{
+	glDeleteFramebuffers(1, &target.framebuffer);
+	glDeleteRenderbuffers(1, &target.depth_stencil_buffer);
+	glDeleteTextures(1, &target.color_texture);
+	target = {};
+}
+
+static bool CreateRenderTarget(RenderTargetData& out_target, int width, int height)
+{
+	out_target = {};
+	out_target.width = width;
+	out_target.height = height;
+
+	GLint previous_framebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+	glGenTextures(1, &out_target.color_texture);
+	glBindTexture(GL_TEXTURE_2D, out_target.color_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Clipping with transforms is done with the stencil buffer.
+	glGenRenderbuffers(1, &out_target.depth_stencil_buffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, out_target.depth_stencil_buffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &out_target.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, out_target.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, out_target.color_texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, out_target.depth_stencil_buffer);
+
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previous_framebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		Rml::Log::Message(Rml::Log::LT_ERROR, "OpenGL framebuffer of size %dx%d is incomplete (0x%x).", width, height, status);
+		DestroyRenderTarget(out_target);
+		return false;
+	}
+
+	CheckGLError("CreateRenderTarget");
+	return true;
+}
+
 } // namespace Gfx
 
 RenderInterface_GL3::RenderInterface_GL3()
@@ -321,10 +790,23 @@ RenderInterface_GL3::RenderInterface_GL3()
 
 	if (!Gfx::CreateShaders(*shaders))
 		shaders.reset();
+
+	streaming_buffer = Rml::MakeUnique<Gfx::StreamingBufferData>();
+	Gfx::CreateStreamingBuffer(*streaming_buffer);
+
+	texture_loader = Rml::MakeUnique<Gfx::TextureLoader>();
+
+	gpu_timers = Rml::MakeUnique<Gfx::GpuTimerQueries>();
 }
 
 RenderInterface_GL3::~RenderInterface_GL3()
 {
+	texture_loader.reset();
+	gpu_timers.reset();
+
+	if (streaming_buffer)
+		Gfx::DestroyStreamingBuffer(*streaming_buffer);
+
 	if (shaders)
 		Gfx::DestroyShaders(*shaders);
 }
@@ -338,7 +820,19 @@ void RenderInterface_GL3::SetViewport(int width, int height)
 void RenderInterface_GL3::BeginFrame()
 {
 	RMLUI_ASSERT(viewport_width >= 0 && viewport_height >= 0);
-	glViewport(0, 0, viewport_width, viewport_height);
+	SetupRenderState(viewport_width, viewport_height);
+
+	draw_calls = 0;
+
+	gpu_timers->NextFrame();
+
+	textures_uploaded = UploadLoadedTextures();
+}
+
+void RenderInterface_GL3::SetupRenderState(int width, int height)
+{
+	framebuffer_height = height;
+	glViewport(0, 0, width, height);
 
 	glClearStencil(0);
 	glClearColor(0, 0, 0, 1);
@@ -353,30 +847,133 @@ void RenderInterface_GL3::BeginFrame()
 	glBlendEquation(GL_FUNC_ADD);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	projection = Rml::Matrix4f::ProjectOrtho(0, (float)viewport_width, (float)viewport_height, 0, -10000, 10000);
+	glDisable(GL_SCISSOR_TEST);
+	scissoring_state = ScissoringState::Disable;
+
+	projection = Rml::Matrix4f::ProjectOrtho(0, (float)width, (float)height, 0, -10000, 10000);
 
 	SetTransform(nullptr);
+
+	stencil_ref = 0;
+	stencil_needs_clear = true;
 }
 
 void RenderInterface_GL3::EndFrame() {}
 
+bool RenderInterface_GL3::UploadLoadedTextures()
+{
+	return texture_loader->UploadFinished();
+}
+
+bool RenderInterface_GL3::HasPendingTextures() const
+{
+	return texture_loader->IsPending();
+}
+
+RenderInterface_GL3::RenderTargetHandle RenderInterface_GL3::CreateRenderTarget(int width, int height)
+{
+	auto target = Rml::MakeUnique<Gfx::RenderTargetData>();
+	if (width <= 0 || height <= 0 || !Gfx::CreateRenderTarget(*target, width, height))
+		return 0;
+
+	return (RenderTargetHandle)target.release();
+}
+
+void RenderInterface_GL3::ReleaseRenderTarget(RenderTargetHandle handle)
+{
+	if (!handle)
+		return;
+
+	Gfx::RenderTargetData* target = (Gfx::RenderTargetData*)handle;
+	Gfx::DestroyRenderTarget(*target);
+	delete target;
+}
+
+Rml::Vector2i RenderInterface_GL3::GetRenderTargetDimensions(RenderTargetHandle handle) const
+{
+	const Gfx::RenderTargetData* target = (const Gfx::RenderTargetData*)handle;
+	return target ? Rml::Vector2i(target->width, target->height) : Rml::Vector2i(0, 0);
+}
+
+uintptr_t RenderInterface_GL3::GetRenderTargetTexture(RenderTargetHandle handle) const
+{
+	const Gfx::RenderTargetData* target = (const Gfx::RenderTargetData*)handle;
+	return target ? (uintptr_t)target->color_texture : 0;
+}
+
+void RenderInterface_GL3::BeginRenderTarget(RenderTargetHandle handle)
+{
+	RMLUI_ASSERT(handle);
+	const Gfx::RenderTargetData& target = *(const Gfx::RenderTargetData*)handle;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+	SetupRenderState(target.width, target.height);
+	Clear();
+}
+
+void RenderInterface_GL3::EndRenderTarget()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	SetupRenderState(viewport_width, viewport_height);
+}
+
+void RenderInterface_GL3::SetTextureLoadedCallback(void (*callback)())
+{
+	texture_loader->SetLoadedCallback(callback);
+}
+
+bool RenderInterface_GL3::IsGpuTimingSupported() const
+{
+	return gpu_timers->IsSupported();
+}
+
+void RenderInterface_GL3::BeginGpuTimer(const Rml::String& name)
+{
+	gpu_timers->Begin(name);
+}
+
+void RenderInterface_GL3::EndGpuTimer()
+{
+	gpu_timers->End();
+}
+
+bool RenderInterface_GL3::PopGpuTimings(Rml::Vector<GpuTiming>& out_timings)
+{
+	return gpu_timers->PopResults(out_timings);
+}
+
 void RenderInterface_GL3::Clear()
 {
 	glClearStencil(0);
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	stencil_ref = 0;
+	stencil_needs_clear = false;
 }
 
 void RenderInterface_GL3::RenderGeometry(Rml::Vertex* vertices, int num_vertices, int* indices, int num_indices, const Rml::TextureHandle texture,
 	const Rml::Vector2f& translation)
 {
-	Rml::CompiledGeometryHandle geometry = CompileGeometry(vertices, num_vertices, indices, num_indices, texture);
+	Gfx::StreamingBufferData& stream = *streaming_buffer;
 
-	if (geometry)
-	{
-		RenderCompiledGeometry(geometry, translation);
-		ReleaseCompiledGeometry(geometry);
-	}
+	glBindVertexArray(stream.vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, stream.vbo);
+	const GLintptr vertex_offset =
+		Gfx::StreamData(GL_ARRAY_BUFFER, stream.vertex_capacity, stream.vertex_offset, vertices, sizeof(Rml::Vertex) * num_vertices);
+	Gfx::SetupVertexAttributes(vertex_offset);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.ibo);
+	const GLintptr index_offset = Gfx::StreamData(GL_ELEMENT_ARRAY_BUFFER, stream.index_capacity, stream.index_offset, indices, sizeof(int) * num_indices);
+
+	UseProgram(texture, translation);
+
+	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, (const GLvoid*)index_offset);
+	glBindVertexArray(0);
+	draw_calls += 1;
+
+	Gfx::CheckGLError("RenderGeometry");
 }
 
 Rml::CompiledGeometryHandle RenderInterface_GL3::CompileGeometry(Rml::Vertex* vertices, int num_vertices, int* indices, int num_indices,
@@ -396,17 +993,7 @@ Rml::CompiledGeometryHandle RenderInterface_GL3::CompileGeometry(Rml::Vertex* ve
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(Rml::Vertex) * num_vertices, (const void*)vertices, draw_usage);
 
-	glEnableVertexAttribArray((GLuint)Gfx::VertexAttribute::Position);
-	glVertexAttribPointer((GLuint)Gfx::VertexAttribute::Position, 2, GL_FLOAT, GL_FALSE, sizeof(Rml::Vertex),
-		(const GLvoid*)(offsetof(Rml::Vertex, position)));
-
-	glEnableVertexAttribArray((GLuint)Gfx::VertexAttribute::Color0);
-	glVertexAttribPointer((GLuint)Gfx::VertexAttribute::Color0, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Rml::Vertex),
-		(const GLvoid*)(offsetof(Rml::Vertex, colour)));
-
-	glEnableVertexAttribArray((GLuint)Gfx::VertexAttribute::TexCoord0);
-	glVertexAttribPointer((GLuint)Gfx::VertexAttribute::TexCoord0, 2, GL_FLOAT, GL_FALSE, sizeof(Rml::Vertex),
-		(const GLvoid*)(offsetof(Rml::Vertex, tex_coord)));
+	Gfx::SetupVertexAttributes(0);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * num_indices, (const void*)indices, draw_usage);
@@ -428,25 +1015,12 @@ void RenderInterface_GL3::RenderCompiledGeometry(Rml::CompiledGeometryHandle han
 {
 	Gfx::CompiledGeometryData* geometry = (Gfx::CompiledGeometryData*)handle;
 
-	if (geometry->texture)
-	{
-		glUseProgram(shaders->program_texture.id);
-		if (geometry->texture != TextureEnableWithoutBinding)
-			glBindTexture(GL_TEXTURE_2D, (GLuint)geometry->texture);
-		SubmitTransformUniform(ProgramId::Texture, shaders->program_texture.uniform_locations[(size_t)Gfx::ProgramUniform::Transform]);
-		glUniform2fv(shaders->program_texture.uniform_locations[(size_t)Gfx::ProgramUniform::Translate], 1, &translation.x);
-	}
-	else
-	{
-		glUseProgram(shaders->program_color.id);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		SubmitTransformUniform(ProgramId::Color, shaders->program_color.uniform_locations[(size_t)Gfx::ProgramUniform::Transform]);
-		glUniform2fv(shaders->program_color.uniform_locations[(size_t)Gfx::ProgramUniform::Translate], 1, &translation.x);
-	}
+	UseProgram(geometry->texture, translation);
 
 	glBindVertexArray(geometry->vao);
 	glDrawElements(GL_TRIANGLES, geometry->draw_count, GL_UNSIGNED_INT, (const GLvoid*)0);
 	glBindVertexArray(0);
+	draw_calls += 1;
 
 	Gfx::CheckGLError("RenderCompiledGeometry");
 }
@@ -481,7 +1055,7 @@ void RenderInterface_GL3::EnableScissorRegion(bool enable)
 		if (new_state == ScissoringState::Scissor)
 			glEnable(GL_SCISSOR_TEST);
 		else if (new_state == ScissoringState::Stencil)
-			glStencilFunc(GL_EQUAL, 1, GLuint(-1));
+			glStencilFunc(GL_EQUAL, stencil_ref, GLuint(-1));
 
 		scissoring_state = new_state;
 	}
@@ -504,41 +1078,30 @@ void RenderInterface_GL3::SetScissorRegion(int x, int y, int width, int height)
 
 		int indices[6] = {0, 2, 1, 0, 3, 2};
 
-		glClear(GL_STENCIL_BUFFER_BIT);
+		// Pixels written by previous clip regions hold smaller reference values, so they fail the equality test without clearing them.
+		if (stencil_needs_clear || stencil_ref >= 255)
+		{
+			glClear(GL_STENCIL_BUFFER_BIT);
+			stencil_ref = 0;
+			stencil_needs_clear = false;
+		}
+		stencil_ref += 1;
+
 		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-		glStencilFunc(GL_ALWAYS, 1, GLuint(-1));
+		glStencilFunc(GL_ALWAYS, stencil_ref, GLuint(-1));
 		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
 		RenderGeometry(vertices, 4, indices, 6, 0, Rml::Vector2f(0, 0));
 
 		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		glStencilFunc(GL_EQUAL, 1, GLuint(-1));
+		glStencilFunc(GL_EQUAL, stencil_ref, GLuint(-1));
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 	}
 	else
 	{
-		glScissor(x, viewport_height - (y + height), width, height);
-	}
-}
-
-// Set to byte packing, or the compiler will expand our struct, which means it won't read correctly from file
-#pragma pack(1)
-struct TGAHeader {
-	char idLength;
-	char colourMapType;
-	char dataType;
-	short int colourMapOrigin;
-	short int colourMapLength;
-	char colourMapDepth;
-	short int xOrigin;
-	short int yOrigin;
-	short int width;
-	short int height;
-	char bitsPerPixel;
-	char imageDescriptor;
-};
-// Restore packing
-#pragma pack()
+		glScissor(x, framebuffer_height - (y + height), width, height);
+	}
+}
 
 bool RenderInterface_GL3::LoadTexture(Rml::TextureHandle& texture_handle, Rml::Vector2i& texture_dimensions, const Rml::String& source)
 {
@@ -549,85 +1112,30 @@ bool RenderInterface_GL3::LoadTexture(Rml::TextureHandle& texture_handle, Rml::V
 		return false;
 	}
 
-	file_interface->Seek(file_handle, 0, SEEK_END);
-	size_t buffer_size = file_interface->Tell(file_handle);
-	file_interface->Seek(file_handle, 0, SEEK_SET);
-
-	if (buffer_size <= sizeof(TGAHeader))
-	{
-		Rml::Log::Message(Rml::Log::LT_ERROR, "Texture file size is smaller than TGAHeader, file is not a valid TGA image.");
-		file_interface->Close(file_handle);
-		return false;
-	}
-
-	using Rml::byte;
-	byte* buffer = new byte[buffer_size];
-	file_interface->Read(buffer, buffer_size, file_handle);
+	const size_t buffer_size = file_interface->Length(file_handle);
+	Rml::Vector<Rml::byte> buffer(buffer_size);
+	const size_t read_size = file_interface->Read(buffer.data(), buffer_size, file_handle);
 	file_interface->Close(file_handle);
 
-	TGAHeader header;
-	memcpy(&header, buffer, sizeof(TGAHeader));
-
-	int color_mode = header.bitsPerPixel / 8;
-	int image_size = header.width * header.height * 4; // We always make 32bit textures
-
-	if (header.dataType != 2)
+	// Only the image header is parsed here, RmlUi needs the dimensions right away for layout. Decoding is done on the loader threads.
+	int width = 0, height = 0, num_channels = 0;
+	if (read_size != buffer_size || !stbi_info_from_memory(buffer.data(), (int)buffer.size(), &width, &height, &num_channels))
 	{
-		Rml::Log::Message(Rml::Log::LT_ERROR, "Only 24/32bit uncompressed TGAs are supported.");
-		delete[] buffer;
+		Rml::Log::Message(Rml::Log::LT_ERROR, "Texture '%s' is not a supported image (PNG, JPG, TGA, BMP, PSD, GIF, HDR, PIC or PNM).", source.c_str());
 		return false;
 	}
 
-	// Ensure we have at least 3 colors
-	if (color_mode < 3)
-	{
-		Rml::Log::Message(Rml::Log::LT_ERROR, "Only 24 and 32bit textures are supported.");
-		delete[] buffer;
+	// Transparent placeholder, displayed until the decoded image is uploaded.
+	const Rml::byte placeholder[4] = {0, 0, 0, 0};
+	if (!GenerateTexture(texture_handle, placeholder, Rml::Vector2i(1, 1)))
 		return false;
-	}
-
-	const byte* image_src = buffer + sizeof(TGAHeader);
-	byte* image_dest = new byte[image_size];
-
-	// Targa is BGR, swap to RGB and flip Y axis
-	for (long y = 0; y < header.height; y++)
-	{
-		long read_index = y * header.width * color_mode;
-		long write_index = ((header.imageDescriptor & 32) != 0) ? read_index : (header.height - y - 1) * header.width * 4;
-		for (long x = 0; x < header.width; x++)
-		{
-			image_dest[write_index] = image_src[read_index + 2];
-			image_dest[write_index + 1] = image_src[read_index + 1];
-			image_dest[write_index + 2] = image_src[read_index];
-			if (color_mode == 4)
-			{
-				const int alpha = image_src[read_index + 3];
-#ifdef RMLUI_SRGB_PREMULTIPLIED_ALPHA
-				image_dest[write_index + 0] = (image_dest[write_index + 0] * alpha) / 255;
-				image_dest[write_index + 1] = (image_dest[write_index + 1] * alpha) / 255;
-				image_dest[write_index + 2] = (image_dest[write_index + 2] * alpha) / 255;
-#endif
-				image_dest[write_index + 3] = (byte)alpha;
-			}
-			else
-			{
-				image_dest[write_index + 3] = 255;
-			}
-
-			write_index += 4;
-			read_index += color_mode;
-		}
-	}
-
-	texture_dimensions.x = header.width;
-	texture_dimensions.y = header.height;
 
-	bool success = GenerateTexture(texture_handle, image_dest, texture_dimensions);
+	texture_dimensions.x = width;
+	texture_dimensions.y = height;
 
-	delete[] image_dest;
-	delete[] buffer;
+	texture_loader->Enqueue((GLuint)texture_handle, std::move(buffer), source);
 
-	return success;
+	return true;
 }
 
 bool RenderInterface_GL3::GenerateTexture(Rml::TextureHandle& texture_handle, const Rml::byte* source, const Rml::Vector2i& source_dimensions)
@@ -657,6 +1165,7 @@ bool RenderInterface_GL3::GenerateTexture(Rml::TextureHandle& texture_handle, co
 
 void RenderInterface_GL3::ReleaseTexture(Rml::TextureHandle texture_handle)
 {
+	texture_loader->Cancel((GLuint)texture_handle);
 	glDeleteTextures(1, (GLuint*)&texture_handle);
 }
 
@@ -667,6 +1176,25 @@ void RenderInterface_GL3::SetTransform(const Rml::Matrix4f* new_transform)
 	transform_dirty_state = ProgramId::All;
 }
 
+void RenderInterface_GL3::UseProgram(Rml::TextureHandle texture, const Rml::Vector2f& translation)
+{
+	if (texture)
+	{
+		glUseProgram(shaders->program_texture.id);
+		if (texture != TextureEnableWithoutBinding)
+			glBindTexture(GL_TEXTURE_2D, (GLuint)texture);
+		SubmitTransformUniform(ProgramId::Texture, shaders->program_texture.uniform_locations[(size_t)Gfx::ProgramUniform::Transform]);
+		glUniform2fv(shaders->program_texture.uniform_locations[(size_t)Gfx::ProgramUniform::Translate], 1, &translation.x);
+	}
+	else
+	{
+		glUseProgram(shaders->program_color.id);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		SubmitTransformUniform(ProgramId::Color, shaders->program_color.uniform_locations[(size_t)Gfx::ProgramUniform::Transform]);
+		glUniform2fv(shaders->program_color.uniform_locations[(size_t)Gfx::ProgramUniform::Translate], 1, &translation.x);
+	}
+}
+
 void RenderInterface_GL3::SubmitTransformUniform(ProgramId program_id, int uniform_location)
 {
 	if ((int)program_id & (int)transform_dirty_state)
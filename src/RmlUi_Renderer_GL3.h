@@ -34,6 +34,9 @@
 
 namespace Gfx {
 struct ShadersData;
+struct StreamingBufferData;
+class TextureLoader;
+class GpuTimerQueries;
 }
 
 class RenderInterface_GL3 : public Rml::RenderInterface {
@@ -54,6 +57,44 @@ public:
 	// Optional, can be used to clear the framebuffer.
 	void Clear();
 
+	// Uploads textures that finished decoding on the loader threads. Called by BeginFrame(), returns true if any texture was updated.
+	bool UploadLoadedTextures();
+	// Returns true while any texture passed to LoadTexture() is still being decoded.
+	bool HasPendingTextures() const;
+	// Sets a function called from a loader thread whenever a texture finished decoding, e.g. to wake up a waiting main loop.
+	void SetTextureLoadedCallback(void (*callback)());
+	// Returns true if the last call to BeginFrame() uploaded any decoded textures, in which case anything using them should be redrawn.
+	bool WereTexturesUploaded() const { return textures_uploaded; }
+
+	// Offscreen render targets with a color texture and a stencil buffer, e.g. to show a context inside another UI. Returns zero on failure.
+	using RenderTargetHandle = uintptr_t;
+	RenderTargetHandle CreateRenderTarget(int width, int height);
+	void ReleaseRenderTarget(RenderTargetHandle handle);
+	Rml::Vector2i GetRenderTargetDimensions(RenderTargetHandle handle) const;
+	// Returns the OpenGL name of the color texture. Its rows are stored bottom-up, so the texture coordinates need to be flipped vertically.
+	uintptr_t GetRenderTargetTexture(RenderTargetHandle handle) const;
+	// Redirects rendering into the render target and clears it, until EndRenderTarget() switches back to the default framebuffer. Call
+	// between BeginFrame() and EndFrame().
+	void BeginRenderTarget(RenderTargetHandle handle);
+	void EndRenderTarget();
+
+	// Number of draw calls issued since BeginFrame().
+	int GetDrawCallCount() const { return draw_calls; }
+
+	struct GpuTiming {
+		Rml::String name;
+		double milliseconds;
+	};
+	// Returns false if the driver cannot measure GPU time, in which case the timer functions below do nothing.
+	bool IsGpuTimingSupported() const;
+	// Measures the GPU time of all commands issued until EndGpuTimer() under the given name. Timers cannot be nested.
+	void BeginGpuTimer(const Rml::String& name);
+	void EndGpuTimer();
+	// Retrieves the timings of a frame recorded a few frames ago, returns false if no new frame has been resolved since the last call.
+	bool PopGpuTimings(Rml::Vector<GpuTiming>& out_timings);
+	// Number of calls to BeginFrame() after which the timings of a frame are resolved, if the GPU finished it by then.
+	static constexpr int GpuTimingLatency = 4;
+
 	// -- Inherited from Rml::RenderInterface --
 
 	void RenderGeometry(Rml::Vertex* vertices, int num_vertices, int* indices, int num_indices, Rml::TextureHandle texture,
@@ -79,6 +120,8 @@ public:
 private:
 	enum class ProgramId { None, Texture = 1, Color = 2, All = (Texture | Color) };
 	void SubmitTransformUniform(ProgramId program_id, int uniform_location);
+	void UseProgram(Rml::TextureHandle texture, const Rml::Vector2f& translation);
+	void SetupRenderState(int width, int height);
 
 	Rml::Matrix4f transform, projection;
 	ProgramId transform_dirty_state = ProgramId::All;
@@ -87,10 +130,23 @@ private:
 	enum class ScissoringState { Disable, Scissor, Stencil };
 	ScissoringState scissoring_state = ScissoringState::Disable;
 
+	// Each transformed clip region is written with a new stencil reference value, so the stencil buffer only needs to be cleared once per
+	// frame, or when the 8-bit reference values run out.
+	int stencil_ref = 0;
+	bool stencil_needs_clear = true;
+
 	int viewport_width = 0;
 	int viewport_height = 0;
+	// Height of the framebuffer currently rendered to, used to flip scissor regions.
+	int framebuffer_height = 0;
+
+	int draw_calls = 0;
+	bool textures_uploaded = false;
 
 	Rml::UniquePtr<Gfx::ShadersData> shaders;
+	Rml::UniquePtr<Gfx::StreamingBufferData> streaming_buffer;
+	Rml::UniquePtr<Gfx::TextureLoader> texture_loader;
+	Rml::UniquePtr<Gfx::GpuTimerQueries> gpu_timers;
 };
 
 /**
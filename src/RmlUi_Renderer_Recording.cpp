@@ -0,0 +1,226 @@
+/*
+ * This source file is part of RmlUi, the HTML/CSS Interface Middleware
+ *
+ * For the latest information, see http://github.com/mikke89/RmlUi
+ *
+ * Copyright (c) 2008-2010 CodePoint Ltd, Shift Technology Ltd
+ * Copyright (c) 2019 The RmlUi Team, and contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "RmlUi_Renderer_Recording.h"
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/FileInterface.h>
+#include <RmlUi/Core/Log.h>
+#include <stdio.h>
+#include "stb_image.h"
+
+RenderInterface_Recording::RenderInterface_Recording() {}
+
+RenderInterface_Recording::~RenderInterface_Recording() {}
+
+void RenderInterface_Recording::BeginFrame()
+{
+	commands.clear();
+	frame_statistics = {};
+}
+
+void RenderInterface_Recording::EndFrame() {}
+
+void RenderInterface_Recording::Record(const Command& command)
+{
+	if (record_commands)
+		commands.push_back(command);
+}
+
+void RenderInterface_Recording::RenderGeometry(Rml::Vertex* /*vertices*/, int num_vertices, int* /*indices*/, int num_indices,
+	Rml::TextureHandle texture, const Rml::Vector2f& /*translation*/)
+{
+	frame_statistics.draw_calls += 1;
+	frame_statistics.vertices += num_vertices;
+	frame_statistics.indices += num_indices;
+
+	Command command = {CommandType::RenderGeometry};
+	command.num_vertices = num_vertices;
+	command.num_indices = num_indices;
+	command.texture = texture;
+	Record(command);
+}
+
+Rml::CompiledGeometryHandle RenderInterface_Recording::CompileGeometry(Rml::Vertex* /*vertices*/, int num_vertices, int* /*indices*/,
+	int num_indices, Rml::TextureHandle texture)
+{
+	const Rml::CompiledGeometryHandle handle = Rml::CompiledGeometryHandle(++last_handle);
+	geometries[handle] = GeometryData{num_vertices, num_indices, texture};
+	frame_statistics.geometry_compiled += 1;
+
+	Command command = {CommandType::CompileGeometry};
+	command.num_vertices = num_vertices;
+	command.num_indices = num_indices;
+	command.texture = texture;
+	command.geometry = handle;
+	Record(command);
+
+	return handle;
+}
+
+void RenderInterface_Recording::RenderCompiledGeometry(Rml::CompiledGeometryHandle handle, const Rml::Vector2f& /*translation*/)
+{
+	auto it = geometries.find(handle);
+	if (it == geometries.end())
+	{
+		Rml::Log::Message(Rml::Log::LT_ERROR, "Rendering unknown compiled geometry %p.", (void*)handle);
+		return;
+	}
+
+	const GeometryData& geometry = it->second;
+	frame_statistics.draw_calls += 1;
+	frame_statistics.compiled_draw_calls += 1;
+	frame_statistics.vertices += geometry.num_vertices;
+	frame_statistics.indices += geometry.num_indices;
+
+	Command command = {CommandType::RenderCompiledGeometry};
+	command.num_vertices = geometry.num_vertices;
+	command.num_indices = geometry.num_indices;
+	command.texture = geometry.texture;
+	command.geometry = handle;
+	Record(command);
+}
+
+void RenderInterface_Recording::ReleaseCompiledGeometry(Rml::CompiledGeometryHandle handle)
+{
+	geometries.erase(handle);
+	frame_statistics.geometry_released += 1;
+
+	Command command = {CommandType::ReleaseCompiledGeometry};
+	command.geometry = handle;
+	Record(command);
+}
+
+void RenderInterface_Recording::EnableScissorRegion(bool enable)
+{
+	frame_statistics.scissor_changes += 1;
+
+	Command command = {CommandType::EnableScissorRegion};
+	command.enable = enable;
+	Record(command);
+}
+
+void RenderInterface_Recording::SetScissorRegion(int x, int y, int width, int height)
+{
+	frame_statistics.scissor_changes += 1;
+
+	Command command = {CommandType::SetScissorRegion};
+	command.x = x;
+	command.y = y;
+	command.width = width;
+	command.height = height;
+	Record(command);
+}
+
+static int ReadCallback(void* user, char* data, int size)
+{
+	Rml::FileHandle file_handle = *static_cast<Rml::FileHandle*>(user);
+	return (int)Rml::GetFileInterface()->Read(data, (size_t)size, file_handle);
+}
+
+static void SkipCallback(void* user, int n)
+{
+	Rml::FileHandle file_handle = *static_cast<Rml::FileHandle*>(user);
+	Rml::GetFileInterface()->Seek(file_handle, n, SEEK_CUR);
+}
+
+static int EofCallback(void* user)
+{
+	Rml::FileHandle file_handle = *static_cast<Rml::FileHandle*>(user);
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	return file_interface->Tell(file_handle) >= file_interface->Length(file_handle);
+}
+
+bool RenderInterface_Recording::LoadTexture(Rml::TextureHandle& texture_handle, Rml::Vector2i& texture_dimensions, const Rml::String& source)
+{
+	Rml::FileInterface* file_interface = Rml::GetFileInterface();
+	Rml::FileHandle file_handle = file_interface->Open(source);
+	if (!file_handle)
+	{
+		return false;
+	}
+
+	// Only the image header is read, which is all that layout needs.
+	const stbi_io_callbacks callbacks = {ReadCallback, SkipCallback, EofCallback};
+	int width = 0, height = 0, num_channels = 0;
+	const bool result = stbi_info_from_callbacks(&callbacks, &file_handle, &width, &height, &num_channels);
+	file_interface->Close(file_handle);
+
+	if (!result)
+	{
+		Rml::Log::Message(Rml::Log::LT_ERROR, "Texture '%s' is not a supported image.", source.c_str());
+		return false;
+	}
+
+	texture_dimensions = Rml::Vector2i(width, height);
+	texture_handle = Rml::TextureHandle(++last_handle);
+	textures[texture_handle] = texture_dimensions;
+	frame_statistics.textures_loaded += 1;
+
+	Command command = {CommandType::LoadTexture};
+	command.texture = texture_handle;
+	command.width = width;
+	command.height = height;
+	Record(command);
+
+	return true;
+}
+
+bool RenderInterface_Recording::GenerateTexture(Rml::TextureHandle& texture_handle, const Rml::byte* /*source*/,
+	const Rml::Vector2i& source_dimensions)
+{
+	texture_handle = Rml::TextureHandle(++last_handle);
+	textures[texture_handle] = source_dimensions;
+	frame_statistics.textures_generated += 1;
+	frame_statistics.texture_bytes_generated += size_t(source_dimensions.x) * size_t(source_dimensions.y) * 4;
+
+	Command command = {CommandType::GenerateTexture};
+	command.texture = texture_handle;
+	command.width = source_dimensions.x;
+	command.height = source_dimensions.y;
+	Record(command);
+
+	return true;
+}
+
+void RenderInterface_Recording::ReleaseTexture(Rml::TextureHandle texture_handle)
+{
+	textures.erase(texture_handle);
+
+	Command command = {CommandType::ReleaseTexture};
+	command.texture = texture_handle;
+	Record(command);
+}
+
+void RenderInterface_Recording::SetTransform(const Rml::Matrix4f* transform)
+{
+	frame_statistics.transform_changes += 1;
+
+	Command command = {CommandType::SetTransform};
+	command.enable = (transform != nullptr);
+	Record(command);
+}
@@ -0,0 +1,136 @@
+/*
+ * This source file is part of RmlUi, the HTML/CSS Interface Middleware
+ *
+ * For the latest information, see http://github.com/mikke89/RmlUi
+ *
+ * Copyright (c) 2008-2010 CodePoint Ltd, Shift Technology Ltd
+ * Copyright (c) 2019 The RmlUi Team, and contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef RMLUI_BACKENDS_RENDERER_RECORDING_H
+#define RMLUI_BACKENDS_RENDERER_RECORDING_H
+
+#include <RmlUi/Core/RenderInterface.h>
+#include <RmlUi/Core/Types.h>
+
+/**
+    A render interface which records the render calls made by RmlUi into memory instead of drawing anything.
+
+    It requires no window or graphics context, making it suitable for measuring the layout and render submission cost of documents on machines
+    without a GPU. Texture dimensions are read from the image headers so that layout matches the GL3 renderer.
+ */
+class RenderInterface_Recording : public Rml::RenderInterface {
+public:
+	enum class CommandType {
+		RenderGeometry,
+		CompileGeometry,
+		RenderCompiledGeometry,
+		ReleaseCompiledGeometry,
+		EnableScissorRegion,
+		SetScissorRegion,
+		LoadTexture,
+		GenerateTexture,
+		ReleaseTexture,
+		SetTransform,
+	};
+
+	struct Command {
+		CommandType type;
+		int num_vertices = 0;
+		int num_indices = 0;
+		Rml::TextureHandle texture = 0;
+		Rml::CompiledGeometryHandle geometry = 0;
+		// The scissor region, or the texture dimensions in width and height.
+		int x = 0, y = 0, width = 0, height = 0;
+		// Scissor enabled state, or whether a transform is set.
+		bool enable = false;
+	};
+
+	struct Statistics {
+		int draw_calls = 0;
+		int compiled_draw_calls = 0;
+		int vertices = 0;
+		int indices = 0;
+		int geometry_compiled = 0;
+		int geometry_released = 0;
+		int scissor_changes = 0;
+		int transform_changes = 0;
+		int textures_loaded = 0;
+		int textures_generated = 0;
+		size_t texture_bytes_generated = 0;
+	};
+
+	RenderInterface_Recording();
+	~RenderInterface_Recording();
+
+	// Clears the recorded commands and the frame statistics.
+	void BeginFrame();
+	void EndFrame();
+
+	// Enable to store every render call in the command list, otherwise only the statistics are gathered.
+	void SetRecordCommands(bool record) { record_commands = record; }
+
+	const Rml::Vector<Command>& GetCommands() const { return commands; }
+	const Statistics& GetFrameStatistics() const { return frame_statistics; }
+
+	// Number of compiled geometries and textures currently held by RmlUi.
+	int GetNumLiveGeometries() const { return (int)geometries.size(); }
+	int GetNumLiveTextures() const { return (int)textures.size(); }
+
+	// -- Inherited from Rml::RenderInterface --
+
+	void RenderGeometry(Rml::Vertex* vertices, int num_vertices, int* indices, int num_indices, Rml::TextureHandle texture,
+		const Rml::Vector2f& translation) override;
+
+	Rml::CompiledGeometryHandle CompileGeometry(Rml::Vertex* vertices, int num_vertices, int* indices, int num_indices,
+		Rml::TextureHandle texture) override;
+	void RenderCompiledGeometry(Rml::CompiledGeometryHandle geometry, const Rml::Vector2f& translation) override;
+	void ReleaseCompiledGeometry(Rml::CompiledGeometryHandle geometry) override;
+
+	void EnableScissorRegion(bool enable) override;
+	void SetScissorRegion(int x, int y, int width, int height) override;
+
+	bool LoadTexture(Rml::TextureHandle& texture_handle, Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+	bool GenerateTexture(Rml::TextureHandle& texture_handle, const Rml::byte* source, const Rml::Vector2i& source_dimensions) override;
+	void ReleaseTexture(Rml::TextureHandle texture_handle) override;
+
+	void SetTransform(const Rml::Matrix4f* transform) override;
+
+private:
+	struct GeometryData {
+		int num_vertices;
+		int num_indices;
+		Rml::TextureHandle texture;
+	};
+
+	void Record(const Command& command);
+
+	bool record_commands = true;
+	Rml::Vector<Command> commands;
+	Statistics frame_statistics;
+
+	uintptr_t last_handle = 0;
+	Rml::UnorderedMap<Rml::CompiledGeometryHandle, GeometryData> geometries;
+	Rml::UnorderedMap<Rml::TextureHandle, Rml::Vector2i> textures;
+};
+
+#endif
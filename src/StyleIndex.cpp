@@ -0,0 +1,585 @@
+#include "StyleIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    bool IsNameChar(char c) {
+        return std::isalnum((unsigned char)c) || c == '-' || c == '_' || (unsigned char)c >= 0x80;
+    }
+
+    bool IsIndexed(const std::filesystem::path& path) {
+        const std::filesystem::path extension = path.extension();
+        return extension == ".rcss" || extension == ".rml";
+    }
+
+    bool StartsWith(const char* p, const char* end, const char* prefix) {
+        const size_t length = std::strlen(prefix);
+        return (size_t)(end - p) >= length && std::memcmp(p, prefix, length) == 0;
+    }
+
+    // Position of the text at p within the text starting at begin.
+    struct TextPosition {
+        int line = 0;
+        const char* line_start = nullptr;
+    };
+
+    TextPosition PositionOf(const char* begin, const char* p) {
+        TextPosition position;
+        position.line = (int)std::count(begin, p, '\n');
+        position.line_start = p;
+        while (position.line_start > begin && position.line_start[-1] != '\n')
+            position.line_start--;
+        return position;
+    }
+
+    // Skips a comment or a string starting at p, keeping track of new lines. Returns false if there is none at p.
+    bool SkipCommentOrString(const char*& p, const char* end, TextPosition& position) {
+        const char* skip_end = nullptr;
+        if (StartsWith(p, end, "/*")) {
+            const char* close = std::search(p + 2, end, "*/", "*/" + 2);
+            skip_end = close == end ? end : close + 2;
+        }
+        else if (*p == '"' || *p == '\'') {
+            const char* close = std::find(p + 1, end, *p);
+            skip_end = close == end ? end : close + 1;
+        }
+        else
+            return false;
+
+        for (; p < skip_end; p++) {
+            if (*p == '\n') {
+                position.line++;
+                position.line_start = p + 1;
+            }
+        }
+        return true;
+    }
+
+    void AddSelectors(const char* p, const char* end, TextPosition position, const std::string& path,
+        std::vector<StyleIndex::Definition>& definitions) {
+        while (p < end) {
+            if (SkipCommentOrString(p, end, position))
+                continue;
+            if (*p == '\n') {
+                position.line++;
+                position.line_start = p + 1;
+            }
+            else if ((*p == '.' || *p == '#') && p + 1 < end && IsNameChar(p[1])) {
+                const char* name_end = p + 1;
+                while (name_end < end && IsNameChar(*name_end))
+                    name_end++;
+                StyleIndex::Definition definition;
+                definition.selector.assign(p, name_end);
+                definition.location.path = path;
+                definition.location.line = position.line;
+                definition.location.start = (int)(p - position.line_start);
+                definition.location.end = (int)(name_end - position.line_start);
+                definitions.push_back(std::move(definition));
+                p = name_end;
+                continue;
+            }
+            p++;
+        }
+    }
+
+    // The selectors of the rules of a style sheet, at the top level and within @media blocks.
+    void ParseStyleSheet(const char* begin, const char* end, TextPosition position, const std::string& path,
+        std::vector<StyleIndex::Definition>& definitions) {
+        // Whether each open block contains rules rather than declarations or keyframes.
+        std::vector<bool> rule_blocks = { true };
+        const char* prelude = begin;
+        TextPosition prelude_position = position;
+
+        const char* p = begin;
+        while (p < end) {
+            if (SkipCommentOrString(p, end, position))
+                continue;
+
+            const char c = *p++;
+            if (c == '\n') {
+                position.line++;
+                position.line_start = p;
+                continue;
+            }
+            if (c != '{' && c != '}' && c != ';')
+                continue;
+
+            if (c == '{') {
+                bool contains_rules = false;
+                if (rule_blocks.back()) {
+                    const char* first = prelude;
+                    while (first < p - 1 && std::isspace((unsigned char)*first))
+                        first++;
+                    if (first < p - 1 && *first == '@')
+                        contains_rules = StartsWith(first, p, "@media");
+                    else
+                        AddSelectors(prelude, p - 1, prelude_position, path, definitions);
+                }
+                rule_blocks.push_back(contains_rules);
+            }
+            else if (c == '}' && rule_blocks.size() > 1)
+                rule_blocks.pop_back();
+
+            prelude = p;
+            prelude_position = position;
+        }
+    }
+
+    void AddUsages(const std::string& name, const std::string& value, std::vector<std::string>& usages) {
+        // Values with data binding expressions can't be told before the document is shown.
+        if (value.find('{') != std::string::npos)
+            return;
+
+        if (name == "class") {
+            std::istringstream classes(value);
+            std::string class_name;
+            while (classes >> class_name)
+                usages.push_back("." + class_name);
+        }
+        else if (name == "id" && !value.empty())
+            usages.push_back("#" + value);
+        else if (name.size() > 11 && name.compare(0, 11, "data-class-") == 0)
+            usages.push_back("." + name.substr(11));
+    }
+
+    // The selectors used by the attributes of a document, and those defined by its <style> blocks.
+    void ParseDocument(const std::string& text, const std::string& path, std::vector<StyleIndex::Definition>& definitions,
+        std::vector<std::string>& usages) {
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        const char* p = begin;
+        while (p < end) {
+            if (StartsWith(p, end, "<!--")) {
+                const char* close = std::search(p + 4, end, "-->", "-->" + 3);
+                p = close == end ? end : close + 3;
+                continue;
+            }
+            if (*p != '<' || p + 1 >= end || !std::isalpha((unsigned char)p[1])) {
+                p++;
+                continue;
+            }
+
+            const char* q = p + 1;
+            while (q < end && IsNameChar(*q))
+                q++;
+            const std::string tag(p + 1, q);
+
+            while (q < end && *q != '>') {
+                const char* name_begin = q;
+                while (q < end && (IsNameChar(*q) || *q == ':'))
+                    q++;
+                if (q == name_begin) {
+                    q++;
+                    continue;
+                }
+                const std::string name(name_begin, q);
+
+                while (q < end && std::isspace((unsigned char)*q))
+                    q++;
+                if (q == end || *q != '=')
+                    continue;
+                q++;
+                while (q < end && std::isspace((unsigned char)*q))
+                    q++;
+
+                const char* value_begin = q;
+                if (q < end && (*q == '"' || *q == '\'')) {
+                    value_begin = q + 1;
+                    q = std::find(value_begin, end, *q);
+                    AddUsages(name, std::string(value_begin, q), usages);
+                    if (q < end)
+                        q++;
+                }
+                else {
+                    while (q < end && !std::isspace((unsigned char)*q) && *q != '>')
+                        q++;
+                    AddUsages(name, std::string(value_begin, q), usages);
+                }
+            }
+            p = q < end ? q + 1 : end;
+
+            if (tag == "style") {
+                const char* close = std::search(p, end, "</style", "</style" + 7);
+                ParseStyleSheet(p, close, PositionOf(begin, p), path, definitions);
+                p = close;
+            }
+        }
+    }
+}
+
+StyleIndex::StyleIndex(std::function<void()> on_update) : m_on_update(std::move(on_update)) {
+    m_thread = std::thread(&StyleIndex::Run, this);
+}
+
+StyleIndex::~StyleIndex() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        UnwatchAll();
+    }
+    m_condition.notify_one();
+    m_thread.join();
+}
+
+void StyleIndex::SetFolder(const std::filesystem::path& folder) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        UnwatchAll();
+        m_jobs.clear();
+        m_generation++;
+        m_version++;
+        m_folder = folder.lexically_normal();
+        m_files.clear();
+        m_definitions.clear();
+        m_usages.clear();
+        m_selector_changes.clear();
+        m_selectors_reset = true;
+    }
+    PushJob(Job{ folder.lexically_normal(), Job::Kind::Tree, {} });
+}
+
+void StyleIndex::OnFilesChanged(const std::filesystem::path& directory, const std::vector<std::string>& names) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_watched.count(directory.string()) == 0)
+            return;
+    }
+    if (names.empty()) {
+        PushJob(Job{ directory, Job::Kind::Directory, {} });
+        return;
+    }
+    for (const std::string& name : names)
+        PushJob(Job{ directory / std::filesystem::u8path(name), Job::Kind::File, {} });
+}
+
+void StyleIndex::OnFileSaved(const std::string& path, const std::string& text) {
+    const std::filesystem::path file_path = std::filesystem::path(path).lexically_normal();
+    if (!IsIndexed(file_path))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::filesystem::path relative = file_path.lexically_relative(m_folder);
+        if (relative.empty() || *relative.begin() == "..")
+            return;
+    }
+    PushJob(Job{ file_path, Job::Kind::Text, text });
+}
+
+bool StyleIndex::IsIndexing() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_busy || !m_jobs.empty();
+}
+
+unsigned int StyleIndex::GetVersion() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_version;
+}
+
+bool StyleIndex::TakeSelectorChanges(bool& reset, std::vector<std::string>& added, std::vector<std::string>& removed) {
+    added.clear();
+    removed.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    reset = m_selectors_reset;
+    if (!reset && m_selector_changes.empty())
+        return false;
+    for (const auto& [selector, present] : m_selector_changes)
+        (present ? added : removed).push_back(selector);
+    m_selector_changes.clear();
+    m_selectors_reset = false;
+    return true;
+}
+
+std::vector<StyleIndex::Location> StyleIndex::FindDefinitions(const std::string& selector) const {
+    std::vector<Location> locations;
+    if (selector.empty())
+        return locations;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto add = [&](const std::string& key) {
+        auto it = m_definitions.find(key);
+        if (it != m_definitions.end())
+            locations.insert(locations.end(), it->second.begin(), it->second.end());
+    };
+    if (selector[0] == '.' || selector[0] == '#')
+        add(selector);
+    else {
+        add("." + selector);
+        add("#" + selector);
+    }
+    return locations;
+}
+
+std::vector<StyleIndex::Definition> StyleIndex::FindUnused() const {
+    std::vector<Definition> unused;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& [selector, locations] : m_definitions) {
+            auto usage = m_usages.find(selector);
+            if (usage != m_usages.end() && usage->second > 0)
+                continue;
+            for (const Location& location : locations)
+                unused.push_back(Definition{ selector, location });
+        }
+    }
+    std::sort(unused.begin(), unused.end(), [](const Definition& a, const Definition& b) {
+        if (a.location.path != b.location.path)
+            return a.location.path < b.location.path;
+        return a.location.line != b.location.line ? a.location.line < b.location.line : a.location.start < b.location.start;
+    });
+    return unused;
+}
+
+std::string StyleIndex::SelectorAt(const std::string& line, int index) {
+    const int size = (int)line.size();
+    int start = std::clamp(index, 0, size);
+    int end = start;
+    while (start > 0 && IsNameChar(line[start - 1]))
+        start--;
+    while (end < size && IsNameChar(line[end]))
+        end++;
+    if (start == end)
+        return std::string();
+
+    const std::string name = line.substr(start, end - start);
+    if (start > 0 && (line[start - 1] == '.' || line[start - 1] == '#'))
+        return line[start - 1] + name;
+    if (name.size() > 11 && name.compare(0, 11, "data-class-") == 0)
+        return "." + name.substr(11);
+
+    // Within the value of a class or id attribute.
+    const size_t quote = start > 0 ? line.find_last_of("\"'", start - 1) : std::string::npos;
+    if (quote != std::string::npos && quote > 0 && line[quote - 1] == '=') {
+        size_t attribute_start = quote - 1;
+        while (attribute_start > 0 && IsNameChar(line[attribute_start - 1]))
+            attribute_start--;
+        const std::string attribute = line.substr(attribute_start, quote - 1 - attribute_start);
+        if (attribute == "class")
+            return "." + name;
+        if (attribute == "id")
+            return "#" + name;
+    }
+    return name;
+}
+
+void StyleIndex::Run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this] { return !m_running || !m_jobs.empty(); });
+        if (!m_running)
+            return;
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        const unsigned int generation = m_generation;
+        m_busy = true;
+        lock.unlock();
+
+        std::error_code error;
+        switch (job.kind) {
+        case Job::Kind::Tree:
+            IndexTree(job.path, generation);
+            break;
+        case Job::Kind::Directory:
+            IndexDirectory(job.path, generation);
+            break;
+        case Job::Kind::Text:
+            IndexFile(job.path, &job.text, generation);
+            break;
+        case Job::Kind::File:
+            // A created directory is indexed as a whole, a deleted file removed.
+            if (std::filesystem::is_directory(job.path, error))
+                IndexTree(job.path, generation);
+            else if (IsIndexed(job.path))
+                IndexFile(job.path, nullptr, generation);
+            else if (!std::filesystem::exists(job.path, error))
+                RemoveTree(job.path, generation);
+            break;
+        }
+        if (m_on_update)
+            m_on_update();
+
+        lock.lock();
+        m_busy = false;
+    }
+}
+
+void StyleIndex::PushJob(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void StyleIndex::IndexTree(const std::filesystem::path& directory, unsigned int generation) {
+    // Only directories containing style sheets or documents are watched, besides the folder itself, so that a large folder doesn't use
+    // up the watches of the system. New files in other directories are found when the folder is opened again.
+    Watch(directory, generation);
+
+    std::vector<std::filesystem::path> directories = { directory };
+    while (!directories.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running || generation != m_generation)
+                return;
+        }
+        const std::filesystem::path current = std::move(directories.back());
+        directories.pop_back();
+
+        bool watched = false;
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(current, error), end; !error && it != end; it.increment(error)) {
+            const std::filesystem::directory_entry& entry = *it;
+            const std::string name = entry.path().filename().string();
+            std::error_code entry_error;
+            if (name.empty() || name[0] == '.' || entry.is_symlink(entry_error))
+                continue;
+            if (entry.is_directory(entry_error))
+                directories.push_back(entry.path());
+            else if (IsIndexed(entry.path())) {
+                if (!watched) {
+                    Watch(current, generation);
+                    watched = true;
+                }
+                IndexFile(entry.path(), nullptr, generation);
+            }
+        }
+    }
+}
+
+void StyleIndex::IndexDirectory(const std::filesystem::path& directory, unsigned int generation) {
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        std::error_code entry_error;
+        if (it->is_regular_file(entry_error) && IsIndexed(it->path()))
+            IndexFile(it->path(), nullptr, generation);
+    }
+
+    // Files of the directory which are gone.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+    std::vector<std::string> removed;
+    for (const auto& [path, entries] : m_files) {
+        const std::filesystem::path file_path(path);
+        if (file_path.parent_path() == directory && !std::filesystem::exists(file_path, error))
+            removed.push_back(path);
+    }
+    for (const std::string& path : removed)
+        RemoveFile(path);
+    if (!removed.empty())
+        m_version++;
+}
+
+void StyleIndex::IndexFile(const std::filesystem::path& path, const std::string* text, unsigned int generation) {
+    const std::string path_string = path.string();
+    std::string file_text;
+    bool exists = text != nullptr;
+    if (!text) {
+        std::ifstream ifs(path, std::ios::binary);
+        exists = (bool)ifs;
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        file_text = ss.str();
+        text = &file_text;
+    }
+
+    FileEntries entries;
+    if (path.extension() == ".rcss")
+        ParseStyleSheet(text->data(), text->data() + text->size(), TextPosition{ 0, text->data() }, path_string, entries.definitions);
+    else
+        ParseDocument(*text, path_string, entries.definitions, entries.usages);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+    RemoveFile(path_string);
+    m_version++;
+    if (!exists)
+        return;
+
+    for (const Definition& definition : entries.definitions)
+        AddDefinition(definition.selector, definition.location);
+    for (const std::string& usage : entries.usages)
+        AddUsage(usage);
+    m_files[path_string] = std::move(entries);
+}
+
+void StyleIndex::RemoveTree(const std::filesystem::path& directory, unsigned int generation) {
+    const std::string prefix = (directory / "").string();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation)
+        return;
+    std::vector<std::string> removed;
+    for (const auto& [path, entries] : m_files) {
+        if (path.compare(0, prefix.size(), prefix) == 0)
+            removed.push_back(path);
+    }
+    for (const std::string& path : removed)
+        RemoveFile(path);
+    if (!removed.empty())
+        m_version++;
+}
+
+void StyleIndex::RemoveFile(const std::string& path) {
+    auto file = m_files.find(path);
+    if (file == m_files.end())
+        return;
+
+    for (const Definition& definition : file->second.definitions) {
+        auto it = m_definitions.find(definition.selector);
+        if (it == m_definitions.end())
+            continue;
+        std::vector<Location>& locations = it->second;
+        locations.erase(std::remove_if(locations.begin(), locations.end(), [&](const Location& location) { return location.path == path; }),
+            locations.end());
+        if (locations.empty()) {
+            m_definitions.erase(it);
+            OnSelectorChanged(definition.selector);
+        }
+    }
+    for (const std::string& usage : file->second.usages) {
+        auto it = m_usages.find(usage);
+        if (it != m_usages.end() && --it->second <= 0) {
+            m_usages.erase(it);
+            OnSelectorChanged(usage);
+        }
+    }
+    m_files.erase(file);
+}
+
+void StyleIndex::AddDefinition(const std::string& selector, const Location& location) {
+    std::vector<Location>& locations = m_definitions[selector];
+    locations.push_back(location);
+    if (locations.size() == 1)
+        OnSelectorChanged(selector);
+}
+
+void StyleIndex::AddUsage(const std::string& selector) {
+    if (++m_usages[selector] == 1)
+        OnSelectorChanged(selector);
+}
+
+void StyleIndex::OnSelectorChanged(const std::string& selector) {
+    // Files are removed before they are indexed again, so a selector often disappears and comes back. Only the final state is kept.
+    m_selector_changes[selector] = m_definitions.count(selector) != 0 || m_usages.count(selector) != 0;
+}
+
+void StyleIndex::Watch(const std::filesystem::path& directory, unsigned int generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation || !m_running || !m_watched.insert(directory.string()).second)
+        return;
+    if (WatchDirectory)
+        WatchDirectory(directory);
+}
+
+void StyleIndex::UnwatchAll() {
+    if (UnwatchDirectory) {
+        for (const std::string& directory : m_watched)
+            UnwatchDirectory(std::filesystem::path(directory));
+    }
+    m_watched.clear();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Index of the class and id selectors defined and used by the style sheets and documents of a folder.
+//
+// Style sheets define the selectors, both .rcss files and <style> blocks of .rml files. Documents use them through their class, id and
+// data-class-* attributes. The folder is read by a background thread, which afterwards re-reads only the files reported as changed. The
+// lookups run on the main thread against hash maps from each selector to where it is defined, so they don't depend on the size of the
+// folder.
+class StyleIndex {
+public:
+    struct Location {
+        std::string path;
+        // Zero based, the characters of the selector within the line.
+        int line = 0;
+        int start = 0;
+        int end = 0;
+    };
+    struct Definition {
+        // Including the leading '.' or '#'.
+        std::string selector;
+        Location location;
+    };
+
+    // on_update is called from the indexing thread whenever the index changed.
+    explicit StyleIndex(std::function<void()> on_update);
+    ~StyleIndex();
+
+    StyleIndex(const StyleIndex&) = delete;
+    StyleIndex& operator=(const StyleIndex&) = delete;
+
+    // Called from the indexing thread for every directory of the folder, and again when the folder is changed or the index destroyed.
+    // Report the changes with OnFilesChanged(). Optional.
+    std::function<void(const std::filesystem::path&)> WatchDirectory;
+    std::function<void(const std::filesystem::path&)> UnwatchDirectory;
+
+    // Indexes the folder from scratch.
+    void SetFolder(const std::filesystem::path& folder);
+    // Names of the entries of the directory which were created, deleted or modified, empty if anything could have changed.
+    void OnFilesChanged(const std::filesystem::path& directory, const std::vector<std::string>& names);
+    // Indexes the text of a file which was just saved, without reading it again.
+    void OnFileSaved(const std::string& path, const std::string& text);
+
+    bool IsIndexing() const;
+    // Changes whenever the index changed, to know when results of the queries below are outdated.
+    unsigned int GetVersion() const;
+
+    // The selectors which started or stopped being defined or used anywhere since the last call, for keeping a copy of the set of selectors
+    // up to date. If reset is set the folder changed and the copy should be replaced with the added selectors. Returns false if nothing
+    // changed.
+    bool TakeSelectorChanges(bool& reset, std::vector<std::string>& added, std::vector<std::string>& removed);
+    std::vector<Location> FindDefinitions(const std::string& selector) const;
+    // Selectors which no document of the folder uses. Classes set from code or data bindings other than data-class-* aren't seen.
+    std::vector<Definition> FindUnused() const;
+
+    // The selector at a character index of a line of a document or style sheet, e.g. ".button" within class="big button" or within
+    // ".button:hover". Just the name, without a leading '.' or '#', if the kind of selector can't be told.
+    static std::string SelectorAt(const std::string& line, int index);
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        enum class Kind { File, Text, Directory, Tree } kind = Kind::File;
+        std::string text;
+    };
+    struct FileEntries {
+        std::vector<Definition> definitions;
+        std::vector<std::string> usages;
+    };
+
+    void Run();
+    void PushJob(Job job);
+    void IndexTree(const std::filesystem::path& directory, unsigned int generation);
+    void IndexDirectory(const std::filesystem::path& directory, unsigned int generation);
+    void IndexFile(const std::filesystem::path& path, const std::string* text, unsigned int generation);
+    void RemoveTree(const std::filesystem::path& directory, unsigned int generation);
+    // Expect the mutex to be locked.
+    void RemoveFile(const std::string& path);
+    void AddDefinition(const std::string& selector, const Location& location);
+    void AddUsage(const std::string& selector);
+    void OnSelectorChanged(const std::string& selector);
+    void Watch(const std::filesystem::path& directory, unsigned int generation);
+    void UnwatchAll();
+
+    std::function<void()> m_on_update;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_jobs;
+    bool m_running = true;
+    bool m_busy = false;
+    // Jobs and results of an older generation belong to the previous folder.
+    unsigned int m_generation = 0;
+    unsigned int m_version = 0;
+    std::filesystem::path m_folder;
+    std::unordered_set<std::string> m_watched;
+
+    std::unordered_map<std::string, FileEntries> m_files;
+    std::unordered_map<std::string, std::vector<Location>> m_definitions;
+    std::unordered_map<std::string, int> m_usages;
+    // Selectors added or removed since TakeSelectorChanges(), with whether they are in the index now.
+    std::unordered_map<std::string, bool> m_selector_changes;
+    bool m_selectors_reset = false;
+};
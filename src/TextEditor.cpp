@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <chrono>
+#include <climits>
 #include <string>
 #include <regex>
 #include <cmath>
@@ -40,14 +41,20 @@ TextEditor::TextEditor()
 	, mCursorPositionChanged(false)
 	, mColorRangeMin(0)
 	, mColorRangeMax(0)
+	, mChangedFirst(INT_MAX)
+	, mChangedLast(-1)
+	, mChangedBaseLines(1)
 	, mSelectionMode(SelectionMode::Normal)
 	, mCheckComments(true)
+	, mCompletionStart(0)
+	, mCompletionSelected(0)
 	, mLastClick(-1.0f)
 	, mHandleKeyboardInputs(true)
 	, mHandleMouseInputs(true)
 	, mIgnoreImGuiChild(false)
 	, mShowWhitespaces(true)
 	, mStartTime(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count())
+	, mCursorDrawn(false)
 {
 	SetPalette(GetDarkPalette());
 	SetLanguageDefinition(LanguageDefinition::HLSL());
@@ -74,6 +81,21 @@ void TextEditor::SetPalette(const Palette & aValue)
 	mPaletteBase = aValue;
 }
 
+float TextEditor::GetRedrawDelay() const
+{
+	// Large buffers are colorized a few lines per frame.
+	if (mColorizerEnabled && !mLines.empty() && (mCheckComments || mColorRangeMin < mColorRangeMax))
+		return 0.0f;
+	if (!mCursorDrawn)
+		return -1.0f;
+
+	// The cursor is shown from 400 ms to 800 ms after mStartTime, see Render().
+	auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto elapsed = (int64_t)(now - mStartTime);
+	auto remaining = elapsed < 400 ? 400 - elapsed : std::max<int64_t>(0, 800 - elapsed);
+	return remaining / 1000.0f;
+}
+
 std::string TextEditor::GetText(const Coordinates & aStart, const Coordinates & aEnd) const
 {
 	std::string result;
@@ -229,6 +251,7 @@ void TextEditor::DeleteRange(const Coordinates & aStart, const Coordinates & aEn
 
 	auto start = GetCharacterIndex(aStart);
 	auto end = GetCharacterIndex(aEnd);
+	MarkLinesChanged(aStart.mLine, aStart.mLine);
 
 	if (aStart.mLine == aEnd.mLine)
 	{
@@ -260,13 +283,16 @@ void TextEditor::DeleteRange(const Coordinates & aStart, const Coordinates & aEn
 int TextEditor::InsertTextAt(Coordinates& /* inout */ aWhere, const char * aValue)
 {
 	assert(!mReadOnly);
+	assert(!mLines.empty());
 
-	int cindex = GetCharacterIndex(aWhere);
-	int totalLines = 0;
+	if (*aValue == '\0')
+		return 0;
+
+	// Split the text into lines first, so that each of them is spliced into the buffer in one go instead of glyph by glyph.
+	Lines newLines(1);
+	int lastLineColumns = 0;
 	while (*aValue != '\0')
 	{
-		assert(!mLines.empty());
-
 		if (*aValue == '\r')
 		{
 			// skip
@@ -274,35 +300,44 @@ int TextEditor::InsertTextAt(Coordinates& /* inout */ aWhere, const char * aValu
 		}
 		else if (*aValue == '\n')
 		{
-			if (cindex < (int)mLines[aWhere.mLine].size())
-			{
-				auto& newLine = InsertLine(aWhere.mLine + 1);
-				auto& line = mLines[aWhere.mLine];
-				newLine.insert(newLine.begin(), line.begin() + cindex, line.end());
-				line.erase(line.begin() + cindex, line.end());
-			}
-			else
-			{
-				InsertLine(aWhere.mLine + 1);
-			}
-			++aWhere.mLine;
-			aWhere.mColumn = 0;
-			cindex = 0;
-			++totalLines;
+			newLines.emplace_back();
+			lastLineColumns = 0;
 			++aValue;
 		}
 		else
 		{
-			auto& line = mLines[aWhere.mLine];
+			auto& line = newLines.back();
 			auto d = UTF8CharLength(*aValue);
 			while (d-- > 0 && *aValue != '\0')
-				line.insert(line.begin() + cindex++, Glyph(*aValue++, PaletteIndex::Default));
-			++aWhere.mColumn;
+				line.emplace_back(Glyph(*aValue++, PaletteIndex::Default));
+			++lastLineColumns;
 		}
+	}
 
-		mTextChanged = true;
+	int cindex = GetCharacterIndex(aWhere);
+	int totalLines = (int)newLines.size() - 1;
+	auto& line = mLines[aWhere.mLine];
+	MarkLinesChanged(aWhere.mLine, aWhere.mLine);
+	if (totalLines == 0)
+	{
+		line.insert(line.begin() + cindex, newLines[0].begin(), newLines[0].end());
+		aWhere.mColumn += lastLineColumns;
+	}
+	else
+	{
+		// the rest of the line moves behind the last inserted line
+		auto& lastLine = newLines.back();
+		lastLine.insert(lastLine.end(), line.begin() + cindex, line.end());
+		line.erase(line.begin() + cindex, line.end());
+		line.insert(line.end(), newLines[0].begin(), newLines[0].end());
+
+		InsertLines(aWhere.mLine + 1, totalLines);
+		std::move(newLines.begin() + 1, newLines.end(), mLines.begin() + aWhere.mLine + 1);
+		aWhere.mLine += totalLines;
+		aWhere.mColumn = lastLineColumns;
 	}
 
+	mTextChanged = true;
 	return totalLines;
 }
 
@@ -600,6 +635,11 @@ void TextEditor::RemoveLine(int aStart, int aEnd)
 	mLines.erase(mLines.begin() + aStart, mLines.begin() + aEnd);
 	assert(!mLines.empty());
 
+	// The lines are removed when joining them to the one before, which is the line that changed.
+	if (aStart <= mChangedLast)
+		mChangedLast = std::max(aStart - 1, mChangedLast - (aEnd - aStart));
+	MarkLinesChanged(std::max(0, aStart - 1), std::max(0, aStart - 1));
+
 	mTextChanged = true;
 }
 
@@ -630,26 +670,61 @@ void TextEditor::RemoveLine(int aIndex)
 	mLines.erase(mLines.begin() + aIndex);
 	assert(!mLines.empty());
 
+	if (aIndex <= mChangedLast)
+		mChangedLast = std::max(aIndex - 1, mChangedLast - 1);
+	MarkLinesChanged(std::max(0, aIndex - 1), std::max(0, aIndex - 1));
+
 	mTextChanged = true;
 }
 
 TextEditor::Line& TextEditor::InsertLine(int aIndex)
+{
+	InsertLines(aIndex, 1);
+	return mLines[aIndex];
+}
+
+void TextEditor::InsertLines(int aIndex, int aCount)
 {
 	assert(!mReadOnly);
 
-	auto& result = *mLines.insert(mLines.begin() + aIndex, Line());
+	mLines.insert(mLines.begin() + aIndex, aCount, Line());
+
+	if (aIndex <= mChangedLast)
+		mChangedLast += aCount;
+	MarkLinesChanged(aIndex, aIndex + aCount - 1);
 
 	ErrorMarkers etmp;
 	for (auto& i : mErrorMarkers)
-		etmp.insert(ErrorMarkers::value_type(i.first >= aIndex ? i.first + 1 : i.first, i.second));
+		etmp.insert(ErrorMarkers::value_type(i.first >= aIndex ? i.first + aCount : i.first, i.second));
 	mErrorMarkers = std::move(etmp);
 
 	Breakpoints btmp;
 	for (auto i : mBreakpoints)
-		btmp.insert(i >= aIndex ? i + 1 : i);
+		btmp.insert(i >= aIndex ? i + aCount : i);
 	mBreakpoints = std::move(btmp);
+}
 
-	return result;
+void TextEditor::MarkLinesChanged(int aFirst, int aLast)
+{
+	mChangedFirst = std::min(mChangedFirst, aFirst);
+	mChangedLast = std::max(mChangedLast, aLast);
+}
+
+bool TextEditor::TakeChangedLines(int& aFirst, int& aLast, int& aLineDelta)
+{
+	if (mChangedFirst > mChangedLast)
+		return false;
+
+	// The marked lines can run past the end after lines were removed there.
+	const int lastLine = (int)mLines.size() - 1;
+	aFirst = std::max(0, std::min(mChangedFirst, lastLine));
+	aLast = std::max(aFirst, std::min(mChangedLast, lastLine));
+	aLineDelta = (int)mLines.size() - mChangedBaseLines;
+
+	mChangedFirst = INT_MAX;
+	mChangedLast = -1;
+	mChangedBaseLines = (int)mLines.size();
+	return true;
 }
 
 std::string TextEditor::GetWordUnderCursor() const
@@ -711,7 +786,14 @@ void TextEditor::HandleKeyboardInputs()
 		io.WantCaptureKeyboard = true;
 		io.WantTextInput = true;
 
-		if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z)))
+		auto cursorBefore = mState.mCursorPosition;
+		bool completionOpen = !mCompletionItems.empty();
+		bool erased = false;
+		bool typed = false;
+
+		if (completionOpen && HandleCompletionInputs())
+			completionOpen = false;
+		else if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z)))
 			Undo();
 		else if (!IsReadOnly() && !ctrl && !shift && alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Backspace)))
 			Undo();
@@ -740,7 +822,10 @@ void TextEditor::HandleKeyboardInputs()
 		else if (!IsReadOnly() && !ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Delete)))
 			Delete();
 		else if (!IsReadOnly() && !ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Backspace)))
+		{
 			Backspace();
+			erased = true;
+		}
 		else if (!ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Insert)))
 			mOverwrite ^= true;
 		else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Insert)))
@@ -764,17 +849,127 @@ void TextEditor::HandleKeyboardInputs()
 
 		if (!IsReadOnly() && !io.InputQueueCharacters.empty())
 		{
+			int count = 0;
 			for (int i = 0; i < io.InputQueueCharacters.Size; i++)
 			{
 				auto c = io.InputQueueCharacters[i];
 				if (c != 0 && (c == '\n' || c >= 32))
-					EnterCharacter(c, shift);
+					io.InputQueueCharacters[count++] = c;
+			}
+
+			// Everything typed during the frame, e.g. an IME commit, is entered as a single edit. Overwriting removes a character for
+			// each one entered, which is left to EnterCharacter.
+			if (mOverwrite)
+			{
+				for (int i = 0; i < count; i++)
+					EnterCharacter(io.InputQueueCharacters[i], shift);
 			}
+			else if (count > 0)
+				EnterCharacters(io.InputQueueCharacters.Data, count);
 			io.InputQueueCharacters.resize(0);
+			typed = count > 0;
 		}
+
+		// Typing asks for completions, erasing updates those shown and anything else moving the cursor closes them.
+		if (typed || (erased && completionOpen))
+			UpdateCompletion();
+		else if (mState.mCursorPosition != cursorBefore)
+			mCompletionItems.clear();
 	}
 }
 
+bool TextEditor::HandleCompletionInputs()
+{
+	auto count = (int)mCompletionItems.size();
+	if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+		mCompletionSelected = (mCompletionSelected + count - 1) % count;
+	else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+		mCompletionSelected = (mCompletionSelected + 1) % count;
+	else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter)) || ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Tab)))
+		AcceptCompletion();
+	else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+		mCompletionItems.clear();
+	else
+		return false;
+	return true;
+}
+
+void TextEditor::UpdateCompletion()
+{
+	mCompletionItems.clear();
+	mCompletionSelected = 0;
+	if (!mCompletionCallback || HasSelection())
+		return;
+
+	auto cursor = GetCursorCharacterIndex();
+	mCompletionStart = cursor;
+	mCompletionCallback(*this, mCompletionStart, mCompletionItems);
+	mCompletionStart = std::max(0, std::min(mCompletionStart, cursor));
+
+	// Nothing left to complete
+	if (mCompletionItems.size() == 1)
+	{
+		auto& line = mLines[mState.mCursorPosition.mLine];
+		auto& item = mCompletionItems[0];
+		if ((int)item.size() == cursor - mCompletionStart &&
+			std::equal(item.begin(), item.end(), line.begin() + mCompletionStart, [](char a, const Glyph& b) { return a == (char)b.mChar; }))
+			mCompletionItems.clear();
+	}
+}
+
+void TextEditor::AcceptCompletion()
+{
+	auto item = mCompletionItems[mCompletionSelected];
+	mCompletionItems.clear();
+	if (IsReadOnly())
+		return;
+
+	UndoRecord u;
+	u.mBefore = mState;
+
+	auto end = GetActualCursorCoordinates();
+	Coordinates start(end.mLine, GetCharacterColumn(end.mLine, mCompletionStart));
+	if (start < end)
+	{
+		u.mRemoved = GetText(start, end);
+		u.mRemovedStart = start;
+		u.mRemovedEnd = end;
+		DeleteRange(start, end);
+	}
+
+	auto pos = start;
+	InsertTextAt(pos, item.c_str());
+	u.mAdded = item;
+	u.mAddedStart = start;
+	u.mAddedEnd = pos;
+
+	SetSelection(pos, pos);
+	SetCursorPosition(pos);
+	u.mAfter = mState;
+	AddUndo(u);
+
+	Colorize(start.mLine - 1, 3);
+}
+
+void TextEditor::RenderCompletion(const ImVec2& aTextScreenPos)
+{
+	// Shown below the completed word, at most a page of the items around the selected one.
+	const int maxVisible = 10;
+	auto line = mState.mCursorPosition.mLine;
+	ImVec2 position(aTextScreenPos.x + TextDistance(line, 0, 0.0f, mCompletionStart), aTextScreenPos.y + (line + 1) * mCharAdvance.y);
+
+	auto first = std::max(0, mCompletionSelected - maxVisible + 1);
+	auto last = std::min((int)mCompletionItems.size(), first + maxVisible);
+
+	ImGui::SetNextWindowPos(position);
+	ImGui::BeginTooltip();
+	for (int i = first; i < last; i++)
+		ImGui::Selectable(mCompletionItems[i].c_str(), i == mCompletionSelected);
+	if (last < (int)mCompletionItems.size())
+		ImGui::TextDisabled("%d more", (int)mCompletionItems.size() - last);
+	ImGui::EndTooltip();
+}
+
 void TextEditor::HandleMouseInputs()
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -787,6 +982,8 @@ void TextEditor::HandleMouseInputs()
 		if (!shift && !alt)
 		{
 			auto click = ImGui::IsMouseClicked(0);
+			if (click)
+				mCompletionItems.clear();
 			auto doubleClick = ImGui::IsMouseDoubleClicked(0);
 			auto t = ImGui::GetTime();
 			auto tripleClick = click && !doubleClick && (mLastClick != -1.0f && (t - mLastClick) < io.MouseDoubleClickTime);
@@ -890,10 +1087,15 @@ void TextEditor::Render()
 	snprintf(buf, 16, " %d ", globalLineMax);
 	mTextStart = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, buf, nullptr, nullptr).x + mLeftMargin;
 
+	mCursorDrawn = false;
 	if (!mLines.empty())
 	{
 		float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
 
+		// The highlights are in document order, the first visible one is looked up and the rest are visited along with the lines.
+		auto highlight = std::lower_bound(mHighlights.begin(), mHighlights.end(), lineNo,
+			[](const TextRange& aRange, int aLine) { return aRange.mLine < aLine; });
+
 		while (lineNo <= lineMax)
 		{
 			ImVec2 lineStartScreenPos = ImVec2(cursorScreenPos.x, cursorScreenPos.y + lineNo * mCharAdvance.y);
@@ -925,6 +1127,24 @@ void TextEditor::Render()
 				drawList->AddRectFilled(vstart, vend, mPalette[(int)PaletteIndex::Selection]);
 			}
 
+			// Draw search highlights, measuring the line only once for all of them
+			int highlightIndex = 0;
+			float highlightDistance = 0.0f;
+			for (; highlight != mHighlights.end() && highlight->mLine == lineNo; ++highlight)
+			{
+				float hstart = TextDistance(lineNo, highlightIndex, highlightDistance, highlight->mStart);
+				float hend = TextDistance(lineNo, highlight->mStart, hstart, highlight->mEnd);
+				highlightIndex = highlight->mEnd;
+				highlightDistance = hend;
+
+				if (hstart < hend)
+				{
+					ImVec2 hvstart(textScreenPos.x + hstart, lineStartScreenPos.y);
+					ImVec2 hvend(textScreenPos.x + hend, lineStartScreenPos.y + mCharAdvance.y);
+					drawList->AddRectFilled(hvstart, hvend, mPalette[(int)PaletteIndex::SearchHighlight]);
+				}
+			}
+
 			// Draw breakpoints
 			auto start = ImVec2(lineStartScreenPos.x + scrollX, lineStartScreenPos.y);
 
@@ -976,6 +1196,7 @@ void TextEditor::Render()
 				// Render the cursor
 				if (focused)
 				{
+					mCursorDrawn = true;
 					auto timeEnd = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 					auto elapsed = timeEnd - mStartTime;
 					if (elapsed > 400)
@@ -1108,6 +1329,14 @@ void TextEditor::Render()
 	}
 
 
+	if (!mCompletionItems.empty())
+	{
+		if (ImGui::IsWindowFocused() && mState.mCursorPosition.mLine < (int)mLines.size())
+			RenderCompletion(ImVec2(cursorScreenPos.x + mTextStart, cursorScreenPos.y));
+		else
+			mCompletionItems.clear();
+	}
+
 	ImGui::Dummy(ImVec2((longest + 2), mLines.size() * mCharAdvance.y));
 
 	if (mScrollToCursor)
@@ -1176,7 +1405,10 @@ void TextEditor::SetText(const std::string & aText)
 
 	mUndoBuffer.clear();
 	mUndoIndex = 0;
+	mHighlights.clear();
+	mCompletionItems.clear();
 
+	MarkLinesChanged(0, (int)mLines.size() - 1);
 	Colorize();
 }
 
@@ -1208,6 +1440,7 @@ void TextEditor::SetTextLines(const std::vector<std::string> & aLines)
 	mUndoBuffer.clear();
 	mUndoIndex = 0;
 
+	MarkLinesChanged(0, (int)mLines.size() - 1);
 	Colorize();
 }
 
@@ -1278,6 +1511,7 @@ void TextEditor::EnterCharacter(ImWchar aChar, bool aShift)
 
 			if (modified)
 			{
+				MarkLinesChanged(start.mLine, end.mLine);
 				start = Coordinates(start.mLine, GetCharacterColumn(start.mLine, 0));
 				Coordinates rangeEnd;
 				if (originalEnd.mColumn != 0)
@@ -1374,6 +1608,7 @@ void TextEditor::EnterCharacter(ImWchar aChar, bool aShift)
 	}
 
 	mTextChanged = true;
+	MarkLinesChanged(coord.mLine, GetActualCursorCoordinates().mLine);
 
 	u.mAddedEnd = GetActualCursorCoordinates();
 	u.mAfter = mState;
@@ -1384,6 +1619,86 @@ void TextEditor::EnterCharacter(ImWchar aChar, bool aShift)
 	EnsureCursorVisible();
 }
 
+void TextEditor::EnterCharacters(const ImWchar* aChars, int aCount)
+{
+	assert(!mReadOnly);
+	assert(!mOverwrite);
+
+	UndoRecord u;
+
+	u.mBefore = mState;
+
+	if (HasSelection())
+	{
+		u.mRemoved = GetSelectedText();
+		u.mRemovedStart = mState.mSelectionStart;
+		u.mRemovedEnd = mState.mSelectionEnd;
+		DeleteSelection();
+	}
+
+	auto start = GetActualCursorCoordinates();
+	auto coord = start;
+	u.mAddedStart = start;
+
+	assert(!mLines.empty());
+
+	Line run;
+	for (int i = 0; i <= aCount; i++)
+	{
+		// characters up to the next new line are inserted together
+		if (i < aCount && aChars[i] != '\n')
+		{
+			char buf[7];
+			int e = ImTextCharToUtf8(buf, 7, aChars[i]);
+			for (int j = 0; j < e; j++)
+				run.push_back(Glyph(buf[j], PaletteIndex::Default));
+			continue;
+		}
+
+		if (!run.empty())
+		{
+			auto& line = mLines[coord.mLine];
+			auto cindex = GetCharacterIndex(coord);
+			line.insert(line.begin() + cindex, run.begin(), run.end());
+			coord = Coordinates(coord.mLine, GetCharacterColumn(coord.mLine, cindex + (int)run.size()));
+			run.clear();
+		}
+
+		if (i < aCount)
+		{
+			InsertLine(coord.mLine + 1);
+			auto& line = mLines[coord.mLine];
+			auto& newLine = mLines[coord.mLine + 1];
+
+			if (mLanguageDefinition.mAutoIndentation)
+				for (size_t it = 0; it < line.size() && isascii(line[it].mChar) && isblank(line[it].mChar); ++it)
+					newLine.push_back(line[it]);
+
+			const size_t whitespaceSize = newLine.size();
+			auto cindex = GetCharacterIndex(coord);
+			newLine.insert(newLine.end(), line.begin() + cindex, line.end());
+			line.erase(line.begin() + cindex, line.begin() + line.size());
+			coord = Coordinates(coord.mLine + 1, GetCharacterColumn(coord.mLine + 1, (int)whitespaceSize));
+		}
+	}
+
+	if (coord == start && u.mRemoved.empty())
+		return;
+
+	SetCursorPosition(coord);
+	mTextChanged = true;
+	MarkLinesChanged(start.mLine, coord.mLine);
+
+	u.mAdded = GetText(start, coord);
+	u.mAddedEnd = coord;
+	u.mAfter = mState;
+
+	AddUndo(u);
+
+	Colorize(start.mLine - 1, coord.mLine - start.mLine + 3);
+	EnsureCursorVisible();
+}
+
 void TextEditor::SetReadOnly(bool aValue)
 {
 	mReadOnly = aValue;
@@ -1805,6 +2120,7 @@ void TextEditor::Delete()
 		}
 
 		mTextChanged = true;
+		MarkLinesChanged(pos.mLine, pos.mLine);
 
 		Colorize(pos.mLine, 1);
 	}
@@ -1882,6 +2198,7 @@ void TextEditor::Backspace()
 		}
 
 		mTextChanged = true;
+		MarkLinesChanged(mState.mCursorPosition.mLine, mState.mCursorPosition.mLine);
 
 		EnsureCursorVisible();
 		Colorize(mState.mCursorPosition.mLine, 1);
@@ -1981,6 +2298,122 @@ void TextEditor::Paste()
 	}
 }
 
+int TextEditor::GetSelectedHighlight() const
+{
+	if (!HasSelection())
+		return -1;
+
+	TextRange selection;
+	selection.mLine = mState.mSelectionStart.mLine;
+	selection.mStart = GetCharacterIndex(mState.mSelectionStart);
+	selection.mEnd = GetCharacterIndex(mState.mSelectionEnd);
+	if (mState.mSelectionEnd.mLine != selection.mLine)
+		return -1;
+
+	auto it = std::lower_bound(mHighlights.begin(), mHighlights.end(), selection, [](const TextRange& aLeft, const TextRange& aRight) {
+		return aLeft.mLine != aRight.mLine ? aLeft.mLine < aRight.mLine : aLeft.mStart < aRight.mStart;
+	});
+	if (it == mHighlights.end() || it->mLine != selection.mLine || it->mStart != selection.mStart || it->mEnd != selection.mEnd)
+		return -1;
+	return (int)(it - mHighlights.begin());
+}
+
+int TextEditor::SelectNextHighlight(bool aBackwards)
+{
+	if (mHighlights.empty())
+		return -1;
+
+	// forwards from the cursor, which is at the end of a selected highlight, backwards from the start of the selection
+	auto from = aBackwards && HasSelection() ? mState.mSelectionStart : GetActualCursorCoordinates();
+	TextRange position;
+	position.mLine = from.mLine;
+	position.mStart = GetCharacterIndex(from);
+	position.mEnd = position.mStart;
+
+	auto it = std::lower_bound(mHighlights.begin(), mHighlights.end(), position, [](const TextRange& aLeft, const TextRange& aRight) {
+		return aLeft.mLine != aRight.mLine ? aLeft.mLine < aRight.mLine : aLeft.mStart < aRight.mStart;
+	});
+
+	int index;
+	if (aBackwards)
+		index = it == mHighlights.begin() ? (int)mHighlights.size() - 1 : (int)(it - mHighlights.begin()) - 1;
+	else
+		index = it == mHighlights.end() ? 0 : (int)(it - mHighlights.begin());
+
+	if (mHighlights[index].mLine >= (int)mLines.size())
+		return -1;
+
+	SelectTextRange(mHighlights[index]);
+	return index;
+}
+
+void TextEditor::SelectTextRange(const TextRange& aRange)
+{
+	if (aRange.mLine < 0 || aRange.mLine >= (int)mLines.size())
+		return;
+
+	Coordinates start(aRange.mLine, GetCharacterColumn(aRange.mLine, aRange.mStart));
+	Coordinates end(aRange.mLine, GetCharacterColumn(aRange.mLine, aRange.mEnd));
+	SetSelection(start, end);
+	SetCursorPosition(end);
+}
+
+void TextEditor::ReplaceHighlights(const std::string& aText, int aFirst, int aCount)
+{
+	if (aCount < 0)
+		aCount = (int)mHighlights.size() - aFirst;
+	if (IsReadOnly() || aFirst < 0 || aCount <= 0 || aFirst + aCount > (int)mHighlights.size())
+		return;
+
+	auto& first = mHighlights[aFirst];
+	auto& last = mHighlights[aFirst + aCount - 1];
+	if (last.mLine >= (int)mLines.size())
+		return;
+
+	// The whole span from the first to the last highlight is replaced at once, by its text with the highlights substituted.
+	std::string added;
+	int line = first.mLine;
+	int index = first.mStart;
+	for (int i = aFirst; i < aFirst + aCount; i++)
+	{
+		auto& range = mHighlights[i];
+		for (; line < range.mLine; line++, index = 0)
+		{
+			for (; index < (int)mLines[line].size(); index++)
+				added += mLines[line][index].mChar;
+			added += '\n';
+		}
+		for (; index < range.mStart && index < (int)mLines[line].size(); index++)
+			added += mLines[line][index].mChar;
+		added += aText;
+		index = std::max(index, range.mEnd);
+	}
+
+	UndoRecord u;
+	u.mBefore = mState;
+
+	Coordinates start(first.mLine, GetCharacterColumn(first.mLine, first.mStart));
+	Coordinates end(last.mLine, GetCharacterColumn(last.mLine, last.mEnd));
+	u.mRemoved = GetText(start, end);
+	u.mRemovedStart = start;
+	u.mRemovedEnd = end;
+	DeleteRange(start, end);
+
+	auto pos = start;
+	int totalLines = InsertTextAt(pos, added.c_str());
+	u.mAdded = added;
+	u.mAddedStart = start;
+	u.mAddedEnd = pos;
+
+	SetSelection(pos, pos);
+	SetCursorPosition(pos);
+	u.mAfter = mState;
+	AddUndo(u);
+
+	mHighlights.clear();
+	Colorize(start.mLine - 1, totalLines + 2);
+}
+
 bool TextEditor::CanUndo() const
 {
 	return !mReadOnly && mUndoIndex > 0;
@@ -2027,6 +2460,7 @@ const TextEditor::Palette & TextEditor::GetDarkPalette()
 			0x40000000, // Current line fill
 			0x40808080, // Current line fill (inactive)
 			0x40a0a0a0, // Current line edge
+			0x6000a0ff, // Search highlight
 		} };
 	return p;
 }
@@ -2055,6 +2489,7 @@ const TextEditor::Palette & TextEditor::GetLightPalette()
 			0x40000000, // Current line fill
 			0x40808080, // Current line fill (inactive)
 			0x40000000, // Current line edge
+			0x4000a0ff, // Search highlight
 		} };
 	return p;
 }
@@ -2083,6 +2518,7 @@ const TextEditor::Palette & TextEditor::GetRetroBluePalette()
 			0x40000000, // Current line fill
 			0x40808080, // Current line fill (inactive)
 			0x40000000, // Current line edge
+			0x6000ffff, // Search highlight
 		} };
 	return p;
 }
@@ -2119,6 +2555,13 @@ std::string TextEditor::GetSelectedText() const
 	return GetText(mState.mSelectionStart, mState.mSelectionEnd);
 }
 
+std::string TextEditor::GetLineText(int aLine) const
+{
+	if (aLine < 0 || aLine >= (int)mLines.size())
+		return std::string();
+	return GetText(Coordinates(aLine, 0), Coordinates(aLine, GetLineMaxColumn(aLine)));
+}
+
 std::string TextEditor::GetCurrentLineText()const
 {
 	auto lineLength = GetLineMaxColumn(mState.mCursorPosition.mLine);
@@ -2391,11 +2834,15 @@ void TextEditor::ColorizeInternal()
 
 float TextEditor::TextDistanceToLineStart(const Coordinates& aFrom) const
 {
-	auto& line = mLines[aFrom.mLine];
-	float distance = 0.0f;
+	return TextDistance(aFrom.mLine, 0, 0.0f, GetCharacterIndex(aFrom));
+}
+
+float TextEditor::TextDistance(int aLine, int aFromIndex, float aFromDistance, int aToIndex) const
+{
+	auto& line = mLines[aLine];
+	float distance = aFromDistance;
 	float spaceSize = ImGui::GetFont()->CalcTextSizeA(ImGui::GetFontSize(), FLT_MAX, -1.0f, " ", nullptr, nullptr).x;
-	int colIndex = GetCharacterIndex(aFrom);
-	for (size_t it = 0u; it < line.size() && it < colIndex; )
+	for (int it = aFromIndex; it < (int)line.size() && it < aToIndex; )
 	{
 		if (line[it].mChar == '\t')
 		{
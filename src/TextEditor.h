@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <map>
 #include <regex>
+#include <functional>
 #include "imgui.h"
 
 class TextEditor
@@ -36,6 +37,7 @@ public:
 		CurrentLineFill,
 		CurrentLineFillInactive,
 		CurrentLineEdge,
+		SearchHighlight,
 		Max
 	};
 
@@ -125,11 +127,22 @@ public:
 		std::string mDeclaration;
 	};
 
+	// A range of characters on one line, as indices into its glyphs, i. e. UTF-8 bytes.
+	struct TextRange
+	{
+		int mLine;
+		int mStart, mEnd;
+	};
+
 	typedef std::string String;
 	typedef std::unordered_map<std::string, Identifier> Identifiers;
 	typedef std::unordered_set<std::string> Keywords;
 	typedef std::map<int, std::string> ErrorMarkers;
 	typedef std::unordered_set<int> Breakpoints;
+	typedef std::vector<TextRange> TextRanges;
+	// Fills aItems with the completions of the text before the cursor, in the order they are offered. They replace the characters of the
+	// cursor line from aStart, an index into the line which is the cursor index on entry.
+	typedef std::function<void(const TextEditor& aEditor, int& aStart, std::vector<std::string>& aItems)> CompletionCallback;
 	typedef std::array<ImU32, (unsigned)PaletteIndex::Max> Palette;
 	typedef uint8_t Char;
 
@@ -194,6 +207,19 @@ public:
 	void SetErrorMarkers(const ErrorMarkers& aMarkers) { mErrorMarkers = aMarkers; }
 	void SetBreakpoints(const Breakpoints& aMarkers) { mBreakpoints = aMarkers; }
 
+	// Search results in document order, only those on the visible lines are drawn. They are not moved by edits.
+	void ClearHighlights() { mHighlights.clear(); }
+	void AddHighlights(const TextRanges& aRanges) { mHighlights.insert(mHighlights.end(), aRanges.begin(), aRanges.end()); }
+	const TextRanges& GetHighlights() const { return mHighlights; }
+	// Index of the highlight which is exactly selected, or -1.
+	int GetSelectedHighlight() const;
+	// Selects the first highlight after the cursor, or the last one before the selection, wrapping around. Returns its index or -1.
+	int SelectNextHighlight(bool aBackwards = false);
+	// Selects the characters of the range and moves the cursor to its end.
+	void SelectTextRange(const TextRange& aRange);
+	// Replaces aCount highlights starting at aFirst, all by default, in a single edit which is undone at once. Clears the highlights.
+	void ReplaceHighlights(const std::string& aText, int aFirst = 0, int aCount = -1);
+
 	void Render(const char* aTitle, const ImVec2& aSize = ImVec2(), bool aBorder = false);
 	void SetText(const std::string& aText);
 	std::string GetText() const;
@@ -203,6 +229,7 @@ public:
 
 	std::string GetSelectedText() const;
 	std::string GetCurrentLineText()const;
+	std::string GetLineText(int aLine) const;
 
 	int GetTotalLines() const { return (int)mLines.size(); }
 	bool IsOverwrite() const { return mOverwrite; }
@@ -210,12 +237,18 @@ public:
 	void SetReadOnly(bool aValue);
 	bool IsReadOnly() const { return mReadOnly; }
 	bool IsTextChanged() const { return mTextChanged; }
+	// The lines edited since the previous call, false if there are none. aFirst to aLast are lines of the current text, the lines before
+	// them are unchanged and the lines after them are the ones which followed the edited lines before, moved down by aLineDelta.
+	bool TakeChangedLines(int& aFirst, int& aLast, int& aLineDelta);
 	bool IsCursorPositionChanged() const { return mCursorPositionChanged; }
+	// Seconds until the editor changes without any input, for the blinking cursor or pending colorization, or a negative value if it won't.
+	float GetRedrawDelay() const;
 
 	bool IsColorizerEnabled() const { return mColorizerEnabled; }
 	void SetColorizerEnable(bool aValue);
 
 	Coordinates GetCursorPosition() const { return GetActualCursorCoordinates(); }
+	int GetCursorCharacterIndex() const { return GetCharacterIndex(GetActualCursorCoordinates()); }
 	void SetCursorPosition(const Coordinates& aPosition);
 
 	inline void SetHandleMouseInputs    (bool aValue){ mHandleMouseInputs    = aValue;}
@@ -236,6 +269,10 @@ public:
 	void InsertText(const std::string& aValue);
 	void InsertText(const char* aValue);
 
+	// Asked for completions whenever characters are typed. The popup is navigated with the arrow keys, Enter or Tab accept an item.
+	void SetCompletionCallback(const CompletionCallback& aCallback) { mCompletionCallback = aCallback; }
+	bool IsCompletionOpen() const { return !mCompletionItems.empty(); }
+
 	void MoveUp(int aAmount = 1, bool aSelect = false);
 	void MoveDown(int aAmount = 1, bool aSelect = false);
 	void MoveLeft(int aAmount = 1, bool aSelect = false, bool aWordMode = false);
@@ -316,6 +353,8 @@ private:
 	void ColorizeRange(int aFromLine = 0, int aToLine = 0);
 	void ColorizeInternal();
 	float TextDistanceToLineStart(const Coordinates& aFrom) const;
+	// Distance of the glyph at aToIndex from the line start, continuing from the distance of an earlier glyph.
+	float TextDistance(int aLine, int aFromIndex, float aFromDistance, int aToIndex) const;
 	void EnsureCursorVisible();
 	int GetPageSize() const;
 	std::string GetText(const Coordinates& aStart, const Coordinates& aEnd) const;
@@ -337,7 +376,10 @@ private:
 	void RemoveLine(int aStart, int aEnd);
 	void RemoveLine(int aIndex);
 	Line& InsertLine(int aIndex);
+	void InsertLines(int aIndex, int aCount);
+	void MarkLinesChanged(int aFirst, int aLast);
 	void EnterCharacter(ImWchar aChar, bool aShift);
+	void EnterCharacters(const ImWchar* aChars, int aCount);
 	void Backspace();
 	void DeleteSelection();
 	std::string GetWordUnderCursor() const;
@@ -345,6 +387,10 @@ private:
 	ImU32 GetGlyphColor(const Glyph& aGlyph) const;
 
 	void HandleKeyboardInputs();
+	bool HandleCompletionInputs();
+	void UpdateCompletion();
+	void AcceptCompletion();
+	void RenderCompletion(const ImVec2& aTextScreenPos);
 	void HandleMouseInputs();
 	void Render();
 
@@ -366,6 +412,8 @@ private:
 	int  mLeftMargin;
 	bool mCursorPositionChanged;
 	int mColorRangeMin, mColorRangeMax;
+	int mChangedFirst, mChangedLast;	// empty if mChangedFirst > mChangedLast
+	int mChangedBaseLines;				// number of lines at the previous TakeChangedLines()
 	SelectionMode mSelectionMode;
 	bool mHandleKeyboardInputs;
 	bool mHandleMouseInputs;
@@ -380,10 +428,16 @@ private:
 	bool mCheckComments;
 	Breakpoints mBreakpoints;
 	ErrorMarkers mErrorMarkers;
+	TextRanges mHighlights;
+	CompletionCallback mCompletionCallback;
+	std::vector<std::string> mCompletionItems;
+	int mCompletionStart;
+	int mCompletionSelected;
 	ImVec2 mCharAdvance;
 	Coordinates mInteractiveStart, mInteractiveEnd;
 	std::string mLineBuffer;
 	uint64_t mStartTime;
+	bool mCursorDrawn;
 
 	float mLastClick;
 };
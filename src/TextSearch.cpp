@@ -0,0 +1,588 @@
+#include "TextSearch.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXT_SEARCH_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+    // Positions matched between checks of the cancel flag.
+    constexpr size_t kCancelInterval = 64 * 1024;
+
+    // Nesting of groups, deeper patterns are rejected instead of running out of stack while compiling them.
+    constexpr int kMaxDepth = 128;
+
+    char Fold(char c) {
+        return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+
+    // Bytes of multi-byte UTF-8 sequences count as word characters, so that words with accented letters aren't split.
+    bool IsWordChar(char c) {
+        const unsigned char u = (unsigned char)c;
+        return u >= 0x80 || u == '_' || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z');
+    }
+
+    void SetBit(std::array<uint64_t, 4>& set, uint8_t c) {
+        set[c >> 6] |= uint64_t(1) << (c & 63);
+    }
+
+    bool TestBit(const std::array<uint64_t, 4>& set, uint8_t c) {
+        return (set[c >> 6] >> (c & 63)) & 1;
+    }
+
+    bool Equals(const char* text, const char* pattern, size_t length, bool case_sensitive) {
+        if (case_sensitive)
+            return memcmp(text, pattern, length) == 0;
+        for (size_t i = 0; i < length; i++) {
+            if (Fold(text[i]) != pattern[i])
+                return false;
+        }
+        return true;
+    }
+
+#ifdef TEXT_SEARCH_SSE2
+    __m128i FoldBlock(__m128i block) {
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+        return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+    }
+
+    int CountTrailingZeros(unsigned int mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (int)index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
+}
+
+// Parses a regular expression into a tree, which is then emitted as a program for the NFA simulation in FindRegex().
+class TextSearch::Compiler {
+public:
+    Compiler(const std::string& pattern, bool case_sensitive, std::vector<Instruction>& program, std::vector<CharClass>& classes)
+        : m_pattern(pattern), m_case_sensitive(case_sensitive), m_program(program), m_classes(classes) {}
+
+    bool Compile(std::string& error) {
+        const int root = ParseAlternation(0);
+        if (root >= 0 && m_pos < m_pattern.size())
+            Fail("Unmatched )");
+        if (!m_error.empty()) {
+            error = m_error;
+            return false;
+        }
+        Emit(root);
+        m_program.push_back({ Op::Match });
+        return true;
+    }
+
+private:
+    enum class Type { Empty, Char, Class, Any, LineStart, LineEnd, WordBoundary, NotWordBoundary, Concat, Alternate, Star, Plus, Quest };
+    struct Node {
+        Type type;
+        uint8_t c = 0;
+        int class_index = 0;
+        bool greedy = true;
+        int left = -1;
+        int right = -1;
+    };
+
+    int Add(const Node& node) {
+        m_nodes.push_back(node);
+        return (int)m_nodes.size() - 1;
+    }
+
+    int Fail(const char* message) {
+        if (m_error.empty())
+            m_error = message;
+        return -1;
+    }
+
+    bool AtEnd() const { return m_pos >= m_pattern.size(); }
+    char Peek() const { return m_pattern[m_pos]; }
+
+    int ParseAlternation(int depth) {
+        if (depth > kMaxDepth)
+            return Fail("Too many nested groups");
+
+        int node = ParseConcat(depth);
+        while (node >= 0 && !AtEnd() && Peek() == '|') {
+            m_pos++;
+            const int right = ParseConcat(depth);
+            if (right < 0)
+                return -1;
+            node = Add({ Type::Alternate, 0, 0, true, node, right });
+        }
+        return node;
+    }
+
+    int ParseConcat(int depth) {
+        int node = Add({ Type::Empty });
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            const int right = ParseRepeat(depth);
+            if (right < 0)
+                return -1;
+            node = Add({ Type::Concat, 0, 0, true, node, right });
+        }
+        return node;
+    }
+
+    int ParseRepeat(int depth) {
+        int node = ParseAtom(depth);
+        while (node >= 0 && !AtEnd() && (Peek() == '*' || Peek() == '+' || Peek() == '?')) {
+            const char op = m_pattern[m_pos++];
+            bool greedy = true;
+            if (!AtEnd() && Peek() == '?') {
+                greedy = false;
+                m_pos++;
+            }
+            const Type type = op == '*' ? Type::Star : op == '+' ? Type::Plus : Type::Quest;
+            node = Add({ type, 0, 0, greedy, node });
+        }
+        return node;
+    }
+
+    int ParseAtom(int depth) {
+        const char c = m_pattern[m_pos++];
+        switch (c) {
+        case '(': {
+            if (m_pattern.compare(m_pos, 2, "?:") == 0)
+                m_pos += 2;
+            const int node = ParseAlternation(depth + 1);
+            if (node < 0)
+                return -1;
+            if (AtEnd() || Peek() != ')')
+                return Fail("Missing )");
+            m_pos++;
+            return node;
+        }
+        case '[': return ParseClass();
+        case '.': return Add({ Type::Any });
+        case '^': return Add({ Type::LineStart });
+        case '$': return Add({ Type::LineEnd });
+        case '*':
+        case '+':
+        case '?': return Fail("Nothing to repeat");
+        case '\\': {
+            if (AtEnd())
+                return Fail("Trailing \\");
+            const char e = m_pattern[m_pos++];
+            if (e == 'b')
+                return Add({ Type::WordBoundary });
+            if (e == 'B')
+                return Add({ Type::NotWordBoundary });
+
+            CharClass set = {};
+            if (AddEscapedClass(e, set))
+                return Add({ Type::Class, 0, AddClass(set, false) });
+            return AddChar(Unescape(e));
+        }
+        default: return AddChar(c);
+        }
+    }
+
+    int ParseClass() {
+        CharClass set = {};
+        bool negate = false;
+        if (!AtEnd() && Peek() == '^') {
+            negate = true;
+            m_pos++;
+        }
+
+        bool first = true;
+        while (true) {
+            if (AtEnd())
+                return Fail("Missing ]");
+            char c = m_pattern[m_pos++];
+            if (c == ']' && !first)
+                break;
+            first = false;
+
+            if (c == '\\') {
+                if (AtEnd())
+                    return Fail("Missing ]");
+                const char e = m_pattern[m_pos++];
+                if (AddEscapedClass(e, set))
+                    continue;
+                c = Unescape(e);
+            }
+
+            char last = c;
+            if (m_pos + 1 < m_pattern.size() && Peek() == '-' && m_pattern[m_pos + 1] != ']') {
+                last = m_pattern[m_pos + 1];
+                m_pos += 2;
+                if (last == '\\') {
+                    if (AtEnd())
+                        return Fail("Missing ]");
+                    last = Unescape(m_pattern[m_pos++]);
+                }
+                if ((unsigned char)last < (unsigned char)c)
+                    return Fail("Invalid range in []");
+            }
+            for (int i = (unsigned char)c; i <= (unsigned char)last; i++)
+                SetBit(set, (uint8_t)i);
+        }
+        return Add({ Type::Class, 0, AddClass(set, negate) });
+    }
+
+    int AddChar(char c) {
+        return Add({ Type::Char, (uint8_t)(m_case_sensitive ? c : Fold(c)) });
+    }
+
+    int AddClass(CharClass set, bool negate) {
+        if (!m_case_sensitive) {
+            for (int c = 'a'; c <= 'z'; c++) {
+                if (TestBit(set, (uint8_t)c) || TestBit(set, (uint8_t)(c - ('a' - 'A')))) {
+                    SetBit(set, (uint8_t)c);
+                    SetBit(set, (uint8_t)(c - ('a' - 'A')));
+                }
+            }
+        }
+        if (negate) {
+            for (uint64_t& bits : set)
+                bits = ~bits;
+        }
+        m_classes.push_back(set);
+        return (int)m_classes.size() - 1;
+    }
+
+    static bool AddEscapedClass(char e, CharClass& set) {
+        CharClass escaped = {};
+        switch (e) {
+        case 'd':
+        case 'D':
+            for (int c = '0'; c <= '9'; c++)
+                SetBit(escaped, (uint8_t)c);
+            break;
+        case 'w':
+        case 'W':
+            for (int c = 0; c < 256; c++) {
+                if (IsWordChar((char)c))
+                    SetBit(escaped, (uint8_t)c);
+            }
+            break;
+        case 's':
+        case 'S':
+            for (char c : { ' ', '\t', '\r', '\n', '\f', '\v' })
+                SetBit(escaped, (uint8_t)c);
+            break;
+        default: return false;
+        }
+        const bool negate = e == 'D' || e == 'W' || e == 'S';
+        for (size_t i = 0; i < set.size(); i++)
+            set[i] |= negate ? ~escaped[i] : escaped[i];
+        return true;
+    }
+
+    static char Unescape(char e) {
+        switch (e) {
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'n': return '\n';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        default: return e;
+        }
+    }
+
+    int Push(Op op, uint8_t c = 0, int x = 0, int y = 0) {
+        m_program.push_back({ op, c, x, y });
+        return (int)m_program.size() - 1;
+    }
+
+    void Emit(int index) {
+        const Node node = m_nodes[index];
+        switch (node.type) {
+        case Type::Empty: break;
+        case Type::Char: Push(Op::Char, node.c); break;
+        case Type::Class: Push(Op::Class, 0, node.class_index); break;
+        case Type::Any: Push(Op::Any); break;
+        case Type::LineStart: Push(Op::LineStart); break;
+        case Type::LineEnd: Push(Op::LineEnd); break;
+        case Type::WordBoundary: Push(Op::WordBoundary); break;
+        case Type::NotWordBoundary: Push(Op::NotWordBoundary); break;
+        case Type::Concat:
+            Emit(node.left);
+            Emit(node.right);
+            break;
+        case Type::Alternate: {
+            const int split = Push(Op::Split);
+            m_program[split].x = split + 1;
+            Emit(node.left);
+            const int jump = Push(Op::Jump);
+            m_program[split].y = (int)m_program.size();
+            Emit(node.right);
+            m_program[jump].x = (int)m_program.size();
+            break;
+        }
+        case Type::Star: {
+            const int split = Push(Op::Split);
+            Emit(node.left);
+            Push(Op::Jump, 0, split);
+            SetTargets(split, split + 1, (int)m_program.size(), node.greedy);
+            break;
+        }
+        case Type::Plus: {
+            const int start = (int)m_program.size();
+            Emit(node.left);
+            const int split = Push(Op::Split);
+            SetTargets(split, start, split + 1, node.greedy);
+            break;
+        }
+        case Type::Quest: {
+            const int split = Push(Op::Split);
+            Emit(node.left);
+            SetTargets(split, split + 1, (int)m_program.size(), node.greedy);
+            break;
+        }
+        }
+    }
+
+    // The repeated branch is preferred by greedy quantifiers, the other one by lazy ones.
+    void SetTargets(int split, int repeat, int skip, bool greedy) {
+        m_program[split].x = greedy ? repeat : skip;
+        m_program[split].y = greedy ? skip : repeat;
+    }
+
+    const std::string& m_pattern;
+    size_t m_pos = 0;
+    bool m_case_sensitive;
+    std::string m_error;
+    std::vector<Node> m_nodes;
+    std::vector<Instruction>& m_program;
+    std::vector<CharClass>& m_classes;
+};
+
+bool TextSearch::SetPattern(const std::string& pattern, const Options& options, std::string* error) {
+    m_options = options;
+    m_pattern.clear();
+    m_program.clear();
+    m_classes.clear();
+
+    if (pattern.find('\n') != std::string::npos) {
+        if (error)
+            *error = "The pattern can't contain new lines";
+        return false;
+    }
+
+    if (options.regex) {
+        std::string message;
+        Compiler compiler(pattern, options.case_sensitive, m_program, m_classes);
+        if (!pattern.empty() && !compiler.Compile(message)) {
+            m_program.clear();
+            m_classes.clear();
+            if (error)
+                *error = message;
+            return false;
+        }
+        m_pattern = pattern;
+    }
+    else {
+        m_pattern = pattern;
+        if (!options.case_sensitive) {
+            for (char& c : m_pattern)
+                c = Fold(c);
+        }
+    }
+    return true;
+}
+
+bool TextSearch::Find(const char* begin, const char* end, const char* from, Match& match, Cursor* cursor) const {
+    if (m_pattern.empty())
+        return false;
+
+    while (from < end) {
+        const char* match_begin = nullptr;
+        const char* match_end = nullptr;
+        if (m_options.regex) {
+            if (!FindRegex(begin, end, from, match_begin, match_end, cursor))
+                return false;
+        }
+        else {
+            match_begin = FindLiteral(from, end);
+            if (!match_begin)
+                return false;
+            match_end = match_begin + m_pattern.size();
+        }
+
+        const bool word_start = match_begin == begin || !IsWordChar(match_begin[-1]) || !IsWordChar(match_begin[0]);
+        const bool word_end = match_end == end || !IsWordChar(match_end[0]) || !IsWordChar(match_end[-1]);
+        if (!m_options.whole_word || (word_start && word_end)) {
+            match.offset = (size_t)(match_begin - begin);
+            match.length = (size_t)(match_end - match_begin);
+            return true;
+        }
+        from = match_begin + 1;
+    }
+    return false;
+}
+
+const char* TextSearch::FindLiteral(const char* from, const char* end) const {
+    const size_t length = m_pattern.size();
+    if ((size_t)(end - from) < length)
+        return nullptr;
+
+    const char* last_start = end - length;
+    const char* p = from;
+    const bool case_sensitive = m_options.case_sensitive;
+
+#ifdef TEXT_SEARCH_SSE2
+    const __m128i first = _mm_set1_epi8(m_pattern.front());
+    const __m128i last = _mm_set1_epi8(m_pattern.back());
+    for (; last_start - p >= 15; p += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)p);
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(p + length - 1));
+        if (!case_sensitive) {
+            block_first = FoldBlock(block_first);
+            block_last = FoldBlock(block_last);
+        }
+
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            const char* candidate = p + CountTrailingZeros(mask);
+            if (Equals(candidate, m_pattern.data(), length, case_sensitive))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    const char first_char = m_pattern.front();
+    for (; p <= last_start; p++) {
+        if ((case_sensitive ? *p : Fold(*p)) == first_char && Equals(p, m_pattern.data(), length, case_sensitive))
+            return p;
+    }
+    return nullptr;
+}
+
+bool TextSearch::FindRegex(const char* begin, const char* end, const char* from, const char*& match_begin, const char*& match_end,
+    Cursor* cursor) const {
+    // Pike's VM: all threads advance through the text together, one per instruction at most, and a thread which started earlier or took
+    // the preferred branch of a split comes first, which gives the leftmost match and the same match as a backtracking engine.
+    struct Thread {
+        int pc;
+        const char* start;
+    };
+    std::vector<Thread> current, next;
+    std::vector<int> stack;
+    std::vector<int> marks(m_program.size(), -1);
+    current.reserve(m_program.size());
+    next.reserve(m_program.size());
+
+    int step = 0;
+    const char* line_begin = from;
+    const char* line_end = nullptr;
+    if (cursor && cursor->end == end && cursor->line_begin && cursor->line_begin <= from && from <= cursor->line_end) {
+        line_begin = cursor->line_begin;
+        line_end = cursor->line_end;
+    }
+    else {
+        while (line_begin > begin && line_begin[-1] != '\n')
+            line_begin--;
+    }
+    const std::atomic<bool>* cancel = cursor ? cursor->cancel : nullptr;
+
+    auto add_thread = [&](std::vector<Thread>& list, int pc, const char* start, const char* sp) {
+        stack.clear();
+        stack.push_back(pc);
+        while (!stack.empty()) {
+            pc = stack.back();
+            stack.pop_back();
+            if (marks[pc] == step)
+                continue;
+            marks[pc] = step;
+
+            const Instruction& instruction = m_program[pc];
+            switch (instruction.op) {
+            case Op::Jump: stack.push_back(instruction.x); break;
+            case Op::Split:
+                stack.push_back(instruction.y);
+                stack.push_back(instruction.x);
+                break;
+            case Op::LineStart:
+                if (sp == line_begin)
+                    stack.push_back(pc + 1);
+                break;
+            case Op::LineEnd:
+                if (sp == line_end)
+                    stack.push_back(pc + 1);
+                break;
+            case Op::WordBoundary:
+            case Op::NotWordBoundary: {
+                const bool before = sp > line_begin && IsWordChar(sp[-1]);
+                const bool after = sp < line_end && IsWordChar(sp[0]);
+                if ((before != after) == (instruction.op == Op::WordBoundary))
+                    stack.push_back(pc + 1);
+                break;
+            }
+            default: list.push_back({ pc, start }); break;
+            }
+        }
+    };
+
+    while (true) {
+        if (!line_end) {
+            line_end = (const char*)memchr(from, '\n', (size_t)(end - from));
+            if (!line_end)
+                line_end = end;
+        }
+
+        bool found = false;
+        current.clear();
+        for (const char* sp = from;; sp++) {
+            if (cancel && (size_t)(sp - from) % kCancelInterval == kCancelInterval - 1 && cancel->load(std::memory_order_relaxed))
+                return false;
+            // A new thread starts at every position until a match was found, with the lowest priority.
+            if (!found)
+                add_thread(current, 0, sp, sp);
+
+            step++;
+            next.clear();
+            for (const Thread& thread : current) {
+                const Instruction& instruction = m_program[thread.pc];
+                bool advance = false;
+                if (instruction.op == Op::Match) {
+                    // Empty matches are of no use for finding text, the thread just ends.
+                    if (sp > thread.start) {
+                        found = true;
+                        match_begin = thread.start;
+                        match_end = sp;
+                        // Threads with a lower priority can't give the preferred match anymore.
+                        break;
+                    }
+                }
+                else if (sp < line_end) {
+                    const char c = *sp;
+                    if (instruction.op == Op::Char)
+                        advance = (m_options.case_sensitive ? c : Fold(c)) == (char)instruction.c;
+                    else if (instruction.op == Op::Class)
+                        advance = TestBit(m_classes[instruction.x], (uint8_t)c);
+                    else if (instruction.op == Op::Any)
+                        advance = true;
+                }
+                if (advance)
+                    add_thread(next, thread.pc + 1, thread.start, sp + 1);
+            }
+            std::swap(current, next);
+            if (sp == line_end || (found && current.empty()))
+                break;
+        }
+        if (cursor) {
+            cursor->end = end;
+            cursor->line_begin = line_begin;
+            cursor->line_end = line_end;
+        }
+        if (found)
+            return true;
+
+        if (line_end == end)
+            return false;
+        line_begin = from = line_end + 1;
+        line_end = nullptr;
+    }
+}
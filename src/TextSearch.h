@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finds a literal string or a regular expression in text. Matches never contain a new line.
+//
+// Literal patterns are scanned 16 bytes at a time where SSE2 is available: the first and the last byte of the pattern are compared at
+// every position of a block at once, and the whole pattern only where both are equal. Regular expressions are compiled into a small NFA
+// which is simulated over each line, so the time taken is linear in the length of the text for every pattern, unlike with std::regex. They
+// support literals, '.', classes such as [a-z] and [^"], the escapes \d \w \s \D \W \S \b \B, the anchors ^ and $, groups, alternation and
+// the greedy and lazy quantifiers * + ?. Case insensitive matching only folds ASCII letters.
+class TextSearch {
+public:
+    struct Options {
+        bool case_sensitive = false;
+        bool whole_word = false;
+        bool regex = false;
+    };
+
+    struct Match {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    // State kept between the calls of one search through a text. Regular expressions are matched line by line, the cursor remembers the
+    // line of the previous match so that finding many matches on a long line doesn't look for its start and end every time.
+    struct Cursor {
+        const char* end = nullptr;
+        const char* line_begin = nullptr;
+        const char* line_end = nullptr;
+        // Polled while matching long lines, the search returns false once it is set.
+        const std::atomic<bool>* cancel = nullptr;
+    };
+
+    // Returns false and describes the problem in error if the regular expression is invalid. An empty pattern never matches.
+    bool SetPattern(const std::string& pattern, const Options& options, std::string* error = nullptr);
+    bool IsEmpty() const { return m_pattern.empty(); }
+
+    // Finds the first non-empty match within [from, end). The text starts at begin, which tells where lines and words start. The offset
+    // of the match is relative to begin. Pass the same cursor to the calls searching on from the previous match.
+    bool Find(const char* begin, const char* end, const char* from, Match& match, Cursor* cursor = nullptr) const;
+
+private:
+    enum class Op : uint8_t { Char, Class, Any, Split, Jump, LineStart, LineEnd, WordBoundary, NotWordBoundary, Match };
+    struct Instruction {
+        Op op;
+        uint8_t c = 0;
+        // Class index or jump target, and the second target of a split, which has the lower priority.
+        int x = 0;
+        int y = 0;
+    };
+    using CharClass = std::array<uint64_t, 4>;
+
+    class Compiler;
+
+    const char* FindLiteral(const char* from, const char* end) const;
+    bool FindRegex(const char* begin, const char* end, const char* from, const char*& match_begin, const char*& match_end, Cursor* cursor) const;
+
+    // Lowercase unless the search is case sensitive.
+    std::string m_pattern;
+    Options m_options;
+    std::vector<Instruction> m_program;
+    std::vector<CharClass> m_classes;
+};
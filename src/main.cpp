@@ -5,14 +5,30 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include "Completion.h"
+#include "FileWatcher.h"
+#include "FindPanel.h"
+#include "FolderSearch.h"
 #include "ImFileDialog.h"
+#include "LogCapture.h"
 #include "TextEditor.h"
+#include "Preview.h"
+#include "PreviewMatrix.h"
+#include "Profiler.h"
+#include "RmlOutline.h"
+#include "StyleIndex.h"
+#include "RmlUi_Renderer_GL3.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <fmt/format.h>
 
 bool ProcessKeyDownShortcuts(Rml::Context* context, Rml::Input::KeyIdentifier key, int key_modifier, float native_dp_ratio, bool priority)
 {
+    // The shortcuts apply to the most recently focused preview instead of the main context.
+    if (Preview* preview = Preview::GetActive())
+        context = preview->GetContext();
     if (!context)
         return true;
 
@@ -92,6 +108,9 @@ void MenuBar() {
             ifd::FileDialog::Instance().Open("FileOpenDialog", "Open a file",
                 "RML/RCSS (*.rcss;*.rml){.rcss,.rml},.*");
         }
+        if (ImGui::MenuItem("Open Folder")) {
+            ifd::FileDialog::Instance().Open("FolderOpenDialog", "Open a folder", "");
+        }
         if (ImGui::MenuItem("Save File")) {
 
         }
@@ -109,6 +128,33 @@ void MenuBar() {
 }
 
 
+// Files referenced by <link> tags of an RML document, such as style sheets and templates, as normalized paths.
+std::vector<std::string> FindLinkedFiles(const std::string& source, const std::string& document_path) {
+    std::vector<std::string> linked_files;
+    const std::filesystem::path base = std::filesystem::path(document_path).parent_path();
+
+    size_t position = 0;
+    while ((position = source.find("<link", position)) != std::string::npos) {
+        const size_t end = source.find('>', position);
+        if (end == std::string::npos)
+            break;
+        const std::string tag = source.substr(position, end - position);
+        position = end;
+
+        const size_t href = tag.find("href");
+        const size_t quote = href == std::string::npos ? std::string::npos : tag.find_first_of("\"'", href);
+        const size_t quote_end = quote == std::string::npos ? std::string::npos : tag.find(tag[quote], quote + 1);
+        if (quote_end == std::string::npos)
+            continue;
+
+        std::filesystem::path path = std::filesystem::u8path(tag.substr(quote + 1, quote_end - quote - 1));
+        if (path.is_relative())
+            path = base / path;
+        linked_files.push_back(path.lexically_normal().string());
+    }
+    return linked_files;
+}
+
 void ReadFonts() {
     Rml::LoadFontFace("fonts/LatoLatin-Regular.ttf", true);
     if (!std::filesystem::exists("fonts.txt")) {
@@ -140,6 +186,9 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    // Messages logged by RmlUi are shown in the editor at the lines they are about.
+    LogCapture::SetCallback([] { Backend::RequestRedraw(); });
+
     // Install the custom interfaces constructed by the backend before initializing RmlUi.
     Rml::SetSystemInterface(Backend::GetSystemInterface());
     Rml::SetRenderInterface(Backend::GetRenderInterface());
@@ -159,22 +208,254 @@ int main(int argc, char* argv[]) {
 
     ReadFonts();
 
+    auto* render_interface = static_cast<RenderInterface_GL3*>(Backend::GetRenderInterface());
+
     struct Document {
         TextEditor text_editor;
-        Rml::ElementDocument* doc = nullptr;
+        std::unique_ptr<Preview> preview;
+        // Closed preview windows are suspended until they are shown again from the View menu.
+        bool show_preview = true;
+        // The same document at several resolutions, created when first shown.
+        std::unique_ptr<PreviewMatrix> matrix;
+        bool show_matrix = false;
+        // Created when first opened with Ctrl+F or Ctrl+H.
+        std::unique_ptr<FindPanel> find_panel;
+        // Elements and syntax errors of .rml documents, parsed again where the text was edited.
+        RmlOutline outline;
+        // Errors and warnings RmlUi logged while loading or updating the previews, by line like the error markers.
+        TextEditor::ErrorMarkers log_markers;
+        // Brings the tab to the front during the next frame.
+        bool select_tab = false;
         bool saved = true;
         std::string file_name;
         std::string file_path;
+        // Files linked from the document, its previews are reloaded when they change on disk.
+        std::vector<std::string> linked_files;
+        std::vector<std::filesystem::path> watched_directories;
     };
     std::vector<Document> text_editors;
     TextEditor editor;
 
+    // Folder of the project being edited, searched by Find in Folder.
+    std::string project_folder = std::filesystem::current_path().string();
+    FolderSearch folder_search([] { Backend::RequestRedraw(); });
+
     bool running = true;
+    bool show_profiler = false;
+    Rml::Vector<RenderInterface_GL3::GpuTiming> gpu_timings;
+
+    // Reports changes to the files of the open documents and to the directories shown by the file dialog.
+    FileWatcher file_watcher([] { Backend::RequestRedraw(); });
+    std::vector<FileWatcher::Change> file_changes;
+    ifd::FileDialog::Instance().WatchDirectory = [&](const std::filesystem::path& directory) { file_watcher.Watch(directory); };
+    ifd::FileDialog::Instance().UnwatchDirectory = [&](const std::filesystem::path& directory) { file_watcher.Unwatch(directory); };
+
+    // Selectors defined and used in the project folder, for go to definition (F12) and the list of unused selectors. Only folders opened
+    // with Open Folder are indexed, the working directory may well be the home directory or the root.
+    StyleIndex style_index([] { Backend::RequestRedraw(); });
+    style_index.WatchDirectory = [&](const std::filesystem::path& directory) { file_watcher.Watch(directory); };
+    style_index.UnwatchDirectory = [&](const std::filesystem::path& directory) { file_watcher.Unwatch(directory); };
+    bool project_indexed = false;
+    bool show_unused_selectors = false;
+    unsigned int unused_selectors_version = 0;
+    std::vector<StyleIndex::Definition> unused_selectors;
+    // Offered in a popup when the selector under the cursor is defined more than once.
+    std::vector<StyleIndex::Location> definition_choices;
+    bool open_definition_choices = false;
+    // Elements of the document of the selected tab.
+    bool show_outline = false;
+    int active_document = -1;
+
+    // Offered while typing, the classes and ids follow the selectors added to and removed from the index.
+    Completion completion;
+    bool selectors_reset = false;
+    std::vector<std::string> selectors_added, selectors_removed;
+    auto set_completion = [&](Document& doc) {
+        const bool style_sheet = std::filesystem::path(doc.file_path).extension() == ".rcss";
+        doc.text_editor.SetCompletionCallback([&completion, style_sheet](const TextEditor& editor, int& start, std::vector<std::string>& items) {
+            completion.Complete(editor, style_sheet, start, items);
+        });
+    };
+
+    // The syntax errors of the outline together with the logged messages.
+    auto set_error_markers = [&](Document& doc) {
+        TextEditor::ErrorMarkers markers = doc.outline.GetErrorMarkers();
+        for (const auto& [line, text] : doc.log_markers) {
+            std::string& marker = markers[line];
+            if (!marker.empty())
+                marker += '\n';
+            marker += text;
+        }
+        doc.text_editor.SetErrorMarkers(markers);
+    };
+    std::vector<LogCapture::Message> log_messages;
+
+    // Watches the directories of the document and of the files it links, call after loading or saving it.
+    auto watch_document = [&](Document& doc) {
+        doc.linked_files = FindLinkedFiles(doc.text_editor.GetText(), doc.file_path);
+
+        std::vector<std::filesystem::path> directories;
+        directories.push_back(std::filesystem::path(doc.file_path).lexically_normal().parent_path());
+        for (const std::string& file : doc.linked_files) {
+            std::filesystem::path directory = std::filesystem::path(file).parent_path();
+            if (std::find(directories.begin(), directories.end(), directory) == directories.end())
+                directories.push_back(directory);
+        }
+
+        // Watch the new set first, so that directories in both aren't dropped in between.
+        for (const std::filesystem::path& directory : directories)
+            file_watcher.Watch(directory);
+        for (const std::filesystem::path& directory : doc.watched_directories)
+            file_watcher.Unwatch(directory);
+        doc.watched_directories = std::move(directories);
+    };
+
+    auto is_file_changed = [&](const std::string& file_path) {
+        const std::filesystem::path path = std::filesystem::path(file_path).lexically_normal();
+        const std::filesystem::path directory = path.parent_path();
+        const std::string name = path.filename().string();
+        for (const FileWatcher::Change& change : file_changes) {
+            if (change.directory == directory &&
+                (change.names.empty() || std::find(change.names.begin(), change.names.end(), name) != change.names.end()))
+                return true;
+        }
+        return false;
+    };
+
+    // Style sheets are only previewed through the documents linking them.
+    auto create_preview = [&](const std::string& path) -> std::unique_ptr<Preview> {
+        if (std::filesystem::path(path).extension() == ".rcss")
+            return nullptr;
+        return std::make_unique<Preview>(render_interface, context->GetDensityIndependentPixelRatio());
+    };
+
+    // Switches to the tab of the file if it is open already.
+    auto open_document = [&](const std::string& path) -> Document& {
+        for (Document& doc : text_editors) {
+            if (std::filesystem::path(doc.file_path).lexically_normal() == std::filesystem::path(path).lexically_normal()) {
+                doc.select_tab = true;
+                return doc;
+            }
+        }
+
+        Document doc;
+        // Read from file
+        std::ifstream ifs(path);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        doc.text_editor.SetText(ss.str());
+        doc.file_name = std::filesystem::path(path).filename().string();
+        doc.file_path = path;
+        doc.preview = create_preview(path);
+        if (doc.preview)
+            doc.preview->Load(ss.str(), path);
+        watch_document(doc);
+        set_completion(doc);
+        doc.select_tab = true;
+        // Open document
+        text_editors.push_back(std::move(doc));
+        return text_editors.back();
+    };
+
+    // Opens the file and selects the characters of the line, don't call while iterating over the documents.
+    auto open_location = [&](const std::string& path, int line, int start, int end) {
+        TextEditor::TextRange range;
+        range.mLine = line;
+        range.mStart = start;
+        range.mEnd = end;
+        open_document(path).text_editor.SelectTextRange(range);
+    };
 
     Rml::ElementDocument* doc = nullptr;
     while (running)
     {
+        Profiler::BeginFrame();
+        Profiler::BeginStage(Profiler::Stage::ProcessEvents);
         running = Backend::ProcessEvents(context, &ProcessKeyDownShortcuts, true);
+        Profiler::EndStage(Profiler::Stage::ProcessEvents);
+        // Only render when something changed, otherwise go back to waiting for events.
+        if (!Backend::IsRedrawNeeded())
+            continue;
+
+        // Changes on disk arrive in batches, e.g. all files touched by a git checkout at once.
+        if (file_watcher.PopChanges(file_changes)) {
+            for (const FileWatcher::Change& change : file_changes)
+                ifd::FileDialog::Instance().OnFilesChanged(change.directory, change.names);
+            for (const FileWatcher::Change& change : file_changes)
+                style_index.OnFilesChanged(change.directory, change.names);
+
+            bool caches_cleared = false;
+            for (Document& doc : text_editors) {
+                const bool source_changed = is_file_changed(doc.file_path);
+                const bool linked_changed = std::any_of(doc.linked_files.begin(), doc.linked_files.end(), is_file_changed);
+                if (!source_changed && !linked_changed)
+                    continue;
+
+                // Unsaved edits take precedence over the file on disk. Our own saves leave the text unchanged.
+                bool text_changed = false;
+                if (source_changed && doc.saved) {
+                    std::ifstream ifs(doc.file_path);
+                    std::stringstream ss;
+                    ss << ifs.rdbuf();
+                    if (ifs && ss.str() != doc.text_editor.GetText()) {
+                        doc.text_editor.SetText(ss.str());
+                        text_changed = true;
+                    }
+                }
+                if (!text_changed && !linked_changed)
+                    continue;
+
+                // RmlUi caches linked style sheets and templates by path.
+                if (linked_changed && !caches_cleared) {
+                    Rml::Factory::ClearStyleSheetCache();
+                    Rml::Factory::ClearTemplateCache();
+                    caches_cleared = true;
+                }
+                doc.log_markers.clear();
+                if (doc.preview)
+                    doc.preview->Load(doc.text_editor.GetText(), doc.file_path);
+                if (doc.matrix)
+                    doc.matrix->Load(doc.text_editor.GetText(), doc.file_path);
+                watch_document(doc);
+                set_error_markers(doc);
+            }
+        }
+
+        // Messages name the file and line they are about, otherwise they belong to the document whose preview logged them.
+        if (LogCapture::Pop(log_messages)) {
+            for (const LogCapture::Message& message : log_messages) {
+                if (message.type != Rml::Log::LT_ERROR && message.type != Rml::Log::LT_ASSERT && message.type != Rml::Log::LT_WARNING)
+                    continue;
+                Document* target = nullptr;
+                int line = -1;
+                for (Document& doc : text_editors) {
+                    if (LogCapture::FindLocation(message.text, doc.file_path, line)) {
+                        target = &doc;
+                        break;
+                    }
+                }
+                for (size_t i = 0; i < text_editors.size() && !target && !message.source.empty(); i++) {
+                    if (text_editors[i].file_path == message.source)
+                        target = &text_editors[i];
+                }
+                if (!target)
+                    continue;
+                if (line < 0)
+                    line = std::max(LogCapture::FindLine(message.text), 0);
+
+                // The previews at several resolutions log the same messages.
+                const std::string text = fmt::format("RmlUi {}: {}", message.type == Rml::Log::LT_WARNING ? "warning" : "error", message.text);
+                std::string& marker = target->log_markers[line + 1];
+                if (marker.find(text) != std::string::npos)
+                    continue;
+                if (!marker.empty())
+                    marker += '\n';
+                marker += text;
+            }
+            for (Document& doc : text_editors)
+                set_error_markers(doc);
+        }
+        Profiler::BeginStage(Profiler::Stage::ImGui);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -185,7 +466,39 @@ int main(int argc, char* argv[]) {
             to_save = true;
         }
 
+        if (style_index.TakeSelectorChanges(selectors_reset, selectors_added, selectors_removed)) {
+            if (selectors_reset)
+                completion.SetSelectors(selectors_added);
+            else
+                completion.UpdateSelectors(selectors_added, selectors_removed);
+        }
+
         MenuBar();
+        bool open_folder_search = ImGui::GetIO().KeyCtrl && ImGui::GetIO().KeyShift && ImGui::IsKeyPressed(ImGuiKey_F, false);
+        if (ImGui::BeginMainMenuBar()) {
+            if (ImGui::BeginMenu("Edit")) {
+                if (ImGui::MenuItem("Find in Folder", "Ctrl+Shift+F"))
+                    open_folder_search = true;
+                ImGui::MenuItem("Unused Selectors", nullptr, &show_unused_selectors);
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("View")) {
+                ImGui::MenuItem("Outline", nullptr, &show_outline);
+                for (size_t i = 0; i < text_editors.size(); i++) {
+                    Document& doc = text_editors[i];
+                    if (!doc.preview)
+                        continue;
+                    ImGui::MenuItem(fmt::format("Preview {}##preview{}", doc.file_name, i).c_str(), nullptr, &doc.show_preview);
+                    if (ImGui::MenuItem(fmt::format("Resolutions {}##matrix{}", doc.file_name, i).c_str(), nullptr, &doc.show_matrix) &&
+                        !doc.matrix) {
+                        doc.matrix = std::make_unique<PreviewMatrix>(render_interface);
+                        doc.matrix->Load(doc.text_editor.GetText(), doc.file_path);
+                    }
+                }
+                ImGui::EndMenu();
+            }
+            ImGui::EndMainMenuBar();
+        }
         int count = 0;
         if (!text_editors.empty()) {
             ImGui::Begin("Main Window");
@@ -193,25 +506,71 @@ int main(int argc, char* argv[]) {
                 for (auto& doc : text_editors) {
                     std::string name = fmt::format("{}##{}", doc.file_name, count);
                     count++;
-                    if (!ImGui::BeginTabItem(name.c_str())) {
+                    const ImGuiTabItemFlags tab_flags = doc.select_tab ? ImGuiTabItemFlags_SetSelected : ImGuiTabItemFlags_None;
+                    doc.select_tab = false;
+                    if (!ImGui::BeginTabItem(name.c_str(), nullptr, tab_flags)) {
                         continue;
                     }
+                    active_document = count - 1;
+                    if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImGui::GetIO().KeyCtrl && !ImGui::GetIO().KeyShift) {
+                        const bool replace = ImGui::IsKeyPressed(ImGuiKey_H, false);
+                        if (replace || ImGui::IsKeyPressed(ImGuiKey_F, false)) {
+                            if (!doc.find_panel)
+                                doc.find_panel = std::make_unique<FindPanel>([] { Backend::RequestRedraw(); });
+                            doc.find_panel->Open(replace);
+                        }
+                    }
+                    if (doc.find_panel && doc.find_panel->Draw(doc.text_editor))
+                        doc.saved = false;
+                    if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImGui::IsKeyPressed(ImGuiKey_F12, false)) {
+                        const std::string selector =
+                            StyleIndex::SelectorAt(doc.text_editor.GetCurrentLineText(), doc.text_editor.GetCursorCharacterIndex());
+                        definition_choices = style_index.FindDefinitions(selector);
+                        open_definition_choices = !definition_choices.empty();
+                    }
+                    Profiler::BeginStage(Profiler::Stage::TextEditor);
                     doc.text_editor.Render(fmt::format("Editor##{}", count).c_str());
+                    Profiler::EndStage(Profiler::Stage::TextEditor);
+                    int first_changed, last_changed, line_delta;
+                    if (doc.text_editor.TakeChangedLines(first_changed, last_changed, line_delta)) {
+                        if (std::filesystem::path(doc.file_path).extension() == ".rml")
+                            doc.outline.Update(doc.text_editor, first_changed, last_changed, line_delta);
+                        // Logged messages move with the lines after the edit until the previews are loaded again.
+                        if (line_delta != 0) {
+                            TextEditor::ErrorMarkers log_markers;
+                            for (const auto& [line, text] : doc.log_markers) {
+                                std::string& marker = log_markers[line - 1 > last_changed - line_delta ? line + line_delta : line];
+                                if (!marker.empty())
+                                    marker += '\n';
+                                marker += text;
+                            }
+                            doc.log_markers = std::move(log_markers);
+                        }
+                        set_error_markers(doc);
+                    }
                     if (doc.text_editor.IsTextChanged()) {
                         doc.saved = false;
+                        Backend::RequestRedraw();
                     }
+                    float editor_delay = doc.text_editor.GetRedrawDelay();
+                    if (editor_delay >= 0.0f)
+                        Backend::ScheduleRedraw(editor_delay);
                     if (to_save) {
                         // Write to file
                         std::ofstream file(doc.file_path);
                         file << doc.text_editor.GetText();
                         doc.saved = true;
                         // Reload document
-                        // Check if it's rcss
-                        if (doc.doc != nullptr) {
-                            doc.doc->Close();
-                        }
-                        doc.doc = context->LoadDocumentFromMemory(doc.text_editor.GetText());
-                        doc.doc->Show();
+                        doc.log_markers.clear();
+                        if (!doc.preview)
+                            doc.preview = create_preview(doc.file_path);
+                        if (doc.preview)
+                            doc.preview->Load(doc.text_editor.GetText(), doc.file_path);
+                        if (doc.matrix)
+                            doc.matrix->Load(doc.text_editor.GetText(), doc.file_path);
+                        watch_document(doc);
+                        style_index.OnFileSaved(doc.file_path, doc.text_editor.GetText());
+                        set_error_markers(doc);
                     }
                     ImGui::EndTabItem();
                 }
@@ -220,6 +579,36 @@ int main(int argc, char* argv[]) {
             ImGui::End();
         }
 
+        Preview* focused_preview = nullptr;
+        for (size_t i = 0; i < text_editors.size(); i++) {
+            Document& doc = text_editors[i];
+            if (!doc.preview || !doc.show_preview)
+                continue;
+            ImGui::SetNextWindowSize(ImVec2(480, 360), ImGuiCond_FirstUseEver);
+            std::string title = fmt::format("Preview - {}##preview{}", doc.file_name, i);
+            if (ImGui::Begin(title.c_str(), &doc.show_preview, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse)) {
+                doc.preview->Draw();
+                if (doc.preview->IsFocused())
+                    focused_preview = doc.preview.get();
+            }
+            ImGui::End();
+        }
+        for (size_t i = 0; i < text_editors.size(); i++) {
+            Document& doc = text_editors[i];
+            if (!doc.matrix || !doc.show_matrix)
+                continue;
+            ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
+            std::string title = fmt::format("Resolutions - {}##matrix{}", doc.file_name, i);
+            if (ImGui::Begin(title.c_str(), &doc.show_matrix, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
+                doc.matrix->Draw();
+            ImGui::End();
+        }
+        // The debugger follows the focused preview.
+        if (focused_preview && focused_preview != Preview::GetActive()) {
+            Rml::Debugger::SetContext(focused_preview->GetContext());
+            focused_preview->SetActive();
+        }
+
         /*        ImGui::Begin("Test");
         if (ImGui::Button("Render")) {
             // Render the rmlui into a new document
@@ -231,21 +620,117 @@ int main(int argc, char* argv[]) {
         ImGui::End();
         */
 
+        if (open_folder_search)
+            folder_search.Open(project_folder);
+        FolderSearch::Location location;
+        if (folder_search.Draw(location))
+            open_location(location.path, location.line, location.start, location.end);
+
+        if (open_definition_choices) {
+            open_definition_choices = false;
+            if (definition_choices.size() == 1) {
+                const StyleIndex::Location& definition = definition_choices[0];
+                open_location(definition.path, definition.line, definition.start, definition.end);
+            }
+            else
+                ImGui::OpenPopup("Definitions");
+        }
+        if (ImGui::BeginPopup("Definitions")) {
+            for (size_t i = 0; i < definition_choices.size(); i++) {
+                const StyleIndex::Location& definition = definition_choices[i];
+                const std::string label = fmt::format("{}:{}##definition{}", definition.path, definition.line + 1, i);
+                if (ImGui::Selectable(label.c_str()))
+                    open_location(definition.path, definition.line, definition.start, definition.end);
+            }
+            ImGui::EndPopup();
+        }
+
+        if (show_unused_selectors) {
+            if (unused_selectors_version != style_index.GetVersion()) {
+                unused_selectors_version = style_index.GetVersion();
+                unused_selectors = style_index.FindUnused();
+            }
+            ImGui::SetNextWindowSize(ImVec2(480, 360), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("Unused Selectors", &show_unused_selectors)) {
+                if (project_indexed)
+                    ImGui::TextDisabled("%s", fmt::format("{} unused in {}{}", unused_selectors.size(), project_folder,
+                        style_index.IsIndexing() ? ", indexing..." : "").c_str());
+                else
+                    ImGui::TextDisabled("Open a folder with File > Open Folder to find its unused selectors.");
+                ImGui::Separator();
+                ImGui::BeginChild("##unused");
+                ImGuiListClipper clipper;
+                clipper.Begin((int)unused_selectors.size());
+                while (clipper.Step()) {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                        const StyleIndex::Definition& unused = unused_selectors[i];
+                        const std::string relative =
+                            std::filesystem::path(unused.location.path).lexically_relative(project_folder).generic_string();
+                        const std::string label = fmt::format("{}  {}:{}##unused{}", unused.selector, relative, unused.location.line + 1, i);
+                        if (ImGui::Selectable(label.c_str()))
+                            open_location(unused.location.path, unused.location.line, unused.location.start, unused.location.end);
+                    }
+                }
+                ImGui::EndChild();
+            }
+            ImGui::End();
+        }
+
+        if (show_outline) {
+            ImGui::SetNextWindowSize(ImVec2(320, 480), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("Outline", &show_outline)) {
+                if (active_document < 0 || active_document >= (int)text_editors.size())
+                    ImGui::TextDisabled("No document");
+                else {
+                    Document& doc = text_editors[active_document];
+                    const std::vector<RmlOutline::Element>& elements = doc.outline.GetElements();
+                    ImGui::TextDisabled("%s", fmt::format("{}: {} elements, {} errors", doc.file_name, elements.size(),
+                        doc.outline.GetErrors().size()).c_str());
+                    ImGui::Separator();
+                    ImGui::BeginChild("##outline");
+                    ImGuiListClipper clipper;
+                    clipper.Begin((int)elements.size());
+                    while (clipper.Step()) {
+                        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                            const RmlOutline::Element& element = elements[i];
+                            std::string label = fmt::format("{:{}}{}", "", element.depth * 2, element.name);
+                            if (!element.id.empty())
+                                label += "#" + element.id;
+                            if (!element.classes.empty()) {
+                                std::string classes = element.classes;
+                                std::replace(classes.begin(), classes.end(), ' ', '.');
+                                label += "." + classes;
+                            }
+                            if (!element.closed)
+                                label += "  (not closed)";
+                            if (ImGui::Selectable(fmt::format("{}##outline{}", label, i).c_str())) {
+                                TextEditor::TextRange range;
+                                range.mLine = element.open_start.line;
+                                range.mStart = element.open_start.column + 1;
+                                range.mEnd = range.mStart + (int)element.name.size();
+                                doc.text_editor.SelectTextRange(range);
+                            }
+                        }
+                    }
+                    ImGui::EndChild();
+                }
+            }
+            ImGui::End();
+        }
+
         if (ifd::FileDialog::Instance().IsDone("FileOpenDialog")) {
+            if (ifd::FileDialog::Instance().HasResult())
+                open_document(ifd::FileDialog::Instance().GetResult().string());
+            ifd::FileDialog::Instance().Close();
+        }
+
+        if (ifd::FileDialog::Instance().IsDone("FolderOpenDialog")) {
             if (ifd::FileDialog::Instance().HasResult()) {
-                std::string res = ifd::FileDialog::Instance().GetResult().string();
-                Document doc;
-                // Read from file
-                std::ifstream ifs(res);
-                std::stringstream ss;
-                ss << ifs.rdbuf();
-                doc.text_editor.SetText(ss.str());
-                doc.file_name = ifd::FileDialog::Instance().GetResult().filename().string();
-                doc.file_path = res;
-                doc.doc = context->LoadDocumentFromMemory(ss.str());
-                doc.doc->Show();
-                // Open document
-                text_editors.push_back(doc);
+                project_folder = ifd::FileDialog::Instance().GetResult().string();
+                style_index.SetFolder(project_folder);
+                project_indexed = true;
+                if (folder_search.IsOpen())
+                    folder_search.Open(project_folder);
             }
             ifd::FileDialog::Instance().Close();
         }
@@ -259,7 +744,9 @@ int main(int argc, char* argv[]) {
                 doc.text_editor.SetText("");
                 doc.file_name = ifd::FileDialog::Instance().GetResult().filename().string();
                 doc.file_path = res;
-                text_editors.push_back(doc);
+                watch_document(doc);
+                set_completion(doc);
+                text_editors.push_back(std::move(doc));
             }
             ifd::FileDialog::Instance().Close();
         }
@@ -275,16 +762,64 @@ int main(int argc, char* argv[]) {
             ifd::FileDialog::Instance().Close();
         }
 
+        if (ImGui::IsKeyPressed(ImGuiKey_F9, false))
+            show_profiler = !show_profiler;
+        if (show_profiler)
+            Profiler::RenderOverlay(&show_profiler);
+        Profiler::EndStage(Profiler::Stage::ImGui);
+
         editor.GetText();
         // Edit the context and update?
         // Make the stuff
+        Profiler::BeginStage(Profiler::Stage::ContextUpdate);
         context->Update();
+        for (Document& doc : text_editors) {
+            if (doc.preview)
+                doc.preview->Update();
+            // Keep the frame responsive, cells that don't fit are updated during the next frames.
+            if (doc.matrix)
+                doc.matrix->Update(8.0);
+        }
+        Profiler::EndStage(Profiler::Stage::ContextUpdate);
 
         Backend::BeginFrame();
+        Profiler::BeginStage(Profiler::Stage::ContextRender);
+        for (Document& doc : text_editors) {
+            if (doc.preview)
+                doc.preview->Render(doc.file_name);
+            if (doc.matrix)
+                doc.matrix->Render(doc.file_name);
+        }
+        render_interface->BeginGpuTimer("Main context");
         context->Render();
+        render_interface->EndGpuTimer();
+        Profiler::EndStage(Profiler::Stage::ContextRender);
+        Profiler::BeginStage(Profiler::Stage::PresentFrame);
         Backend::PresentFrame();
+        Profiler::EndStage(Profiler::Stage::PresentFrame);
+
+        int imgui_draw_calls = 0;
+        if (ImDrawData* draw_data = ImGui::GetDrawData()) {
+            for (int i = 0; i < draw_data->CmdListsCount; i++)
+                imgui_draw_calls += draw_data->CmdLists[i]->CmdBuffer.Size;
+        }
+        Profiler::EndFrame(render_interface->GetDrawCallCount(), imgui_draw_calls);
+
+        Profiler::SetGpuTimingSupported(render_interface->IsGpuTimingSupported());
+        if (render_interface->PopGpuTimings(gpu_timings)) {
+            std::vector<Profiler::GpuTiming> timings;
+            for (const RenderInterface_GL3::GpuTiming& timing : gpu_timings)
+                timings.push_back({ timing.name, timing.milliseconds });
+            Profiler::AddGpuTimings(timings);
+        }
     }
 
+    // The previews remove their contexts, so they need to go before RmlUi.
+    text_editors.clear();
+    // The file dialog outlives the watcher.
+    ifd::FileDialog::Instance().WatchDirectory = nullptr;
+    ifd::FileDialog::Instance().UnwatchDirectory = nullptr;
+
     // Shutdown RmlUi.
     Rml::Shutdown();
 